@@ -4,8 +4,32 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <inttypes.h>
-#include <stdint.h>
+#include <string.h>
+#include <errno.h>
 #include "bn.h"
+#include "tarski.h"
+#include "coordinator.h"
+#include "worldfile.h"
+#include "query.h"
+#include "tablecache.h"
+#include "estimate.h"
+#include "sample.h"
+#include "sentence.h"
+#include "models.h"
+#include "batch.h"
+#include "edit.h"
+#include "solve.h"
+#include "zdd.h"
+#include "frontier.h"
+#include "pipeline.h"
+#include "rank.h"
+#include "canon.h"
+#include "dist.h"
+#include "orbit.h"
+#include "kernels.h"
+#include "perfcount.h"
+#include "rng.h"
+#include <time.h>
 
 // bn implements Arbitrary-precision arithmetic
 // Will manage the large numbers (final_count, nCr) used 
@@ -13,178 +37,8 @@
 // Source:
 // 	https://github.com/kokke/tiny-bignum-c
 
-#define NUM_VALID_OBJECTS 24576
-#define MAX_OBJECTS_IN_WORLD 12
-
 // Tarski's World
 
-// Requires: w is non-null, sizeof_w == length of w
-// Modifies: none
-// Returns: true if no labels are repeated, else false
-bool letter_check(uint32_t sizeof_w, uint32_t* w)
-{
-	// All the labels in use
-	uint8_t labels = 0;
-	uint8_t label; // The current labels on the object
-	
-	for(uint32_t i = 0; i < sizeof_w; i++)
-	{
-		label = w[i] & 63;
-		if(labels & label) return false;
-		labels = labels | label; 
-	}
-	return true;
-}
-
-bool location_check_v2(uint32_t sizeof_w, uint32_t* w)
-{
-	// World representation: Each column is two bits (reversed), each row is each element in the array
-	// Please note the the right side is x == 0, leftside is x == 7
-	// If the point has 0, nothing occupies it
-	// If the point has 1, a center occupies it
-	// If the point has 2, a edge of a large object occupies it
-	uint16_t world[8] = {0,0,0,0,0,0,0,0};
-	
-	for(uint32_t i = 0; i < sizeof_w; i++)
-	{
-		uint8_t c = (w[i] >> 6) & 63;
-		
-		uint8_t cy = c & 7;
-		uint8_t cx = (c >> 2) & 14; // We want this to be multiplied by 2 - really the shift left
-
-		// Y position above and below the center
-		uint8_t by = cy + 1;
-		uint8_t ty = cy - 1;
-		
-		uint8_t large = (w[i] >> 15) & 1;
-
-		// Placement of object
-		if((world[cy] >> cx) & 3) // If center is occupied by 1 or 2
-			return false;
-		
-		world[cy] = world[cy] | (1 << cx); 
-		if(large) 
-		{ // Bound search
-			uint16_t e_bit =  (2 << cx);
-			if(cx != 14) 
-			{ // Check "left" side
-				if((world[cy] >> cx) & 4) return false; // If space if occupied by a center
-				else world[cy] = world[cy] | (e_bit << 2);
-			}
-			if(cx) 
-			{ // Check "right" side - x >= 2
-				if((world[cy] >> (cx - 2)) & 1) return false; // If space if occupied by a center
-				else world[cy] = world[cy] | (e_bit >> 2);
-			}
-
-			if(cy != 7) 
-			{ // Check bottom
-				if((world[by] >> cx) & 1) return false;
-				else world[by] = world[by] | e_bit;
-			}
-			if(cy) 
-			{ // Check top (y != 0)
-				if((world[ty] >> cx) & 1) return false;
-				else world[ty] = world[ty] | e_bit;
-			}
-
-			// Edge cases
-			if(cx != 14 && cy) 
-			{ // Check "left" and up side
-				if((world[ty] >> cx) & 4) return false; // If space if occupied by a center
-				else world[ty] = world[ty] | (e_bit << 2);
-			}
-
-			if(cx && cy) 
-			{ // Check "right" and up side - x >= 2
-				if((world[ty] >> (cx - 2)) & 1) return false; // If space if occupied by a center
-				else world[ty] = world[ty] | (e_bit >> 2);
-			}
-
-			if(cx != 14 && cy != 7) 
-			{ // Check "left" and bottom side
-				if((world[by] >> cx) & 4) return false; // If space if occupied by a center
-				else world[by] = world[by] | (e_bit << 2);
-			}
-
-			if(cx && cy != 7) 
-			{ // Check "right" and bottom side - x >= 2
-				if((world[by] >> (cx - 2)) & 1) return false; // If space if occupied by a center
-				else world[by] = world[by] | (e_bit >> 2);
-			}	    
-		}
-	}
-	
-	return true;
-}
-
-// Requires: l contains 2 valid objects (18-bit numbers)
-// Returns: true if the locations of the objects do not conflict
-bool location_check(uint32_t l_[])
-{
-	int c0c = (l_[0] & 4032) >> 6;
-	int c1c = (l_[1] & 4032) >> 6;
-	
-	int c0x = (c0c & 56) >> 3;
-	int c0y = c0c & 7;
-	
-	int c1x = (c1c & 56) >> 3;
-	int c1y = c1c & 7;
-	
-	int c0large = (l_[0] & (1 << 15)) >> 15;
-	int c1large = (l_[1] & (1 << 15)) >> 15;
-	
-	// if they are the exact same location, return false
-	if(!(c0c ^ c1c))
-	return false;
-	
-	// if either shape is large
-	if(c0large | c1large)
-	{
-		// Their centers must at least have 1 square between them
-		if(!((abs(c0x - c1x) > 1) || (abs(c0y - c1y) > 1)))
-		return false;
-	}
-	return true;
-}
-
-// Requires: Requires: sizeof_w == length of w
-// Modifies: nothing
-// Effects: Prints all elements of w[] with spaces, and a new line at the end
-// Note: Only for debugging; never actually called
-void print_world(uint32_t w[], int sizeof_w)
-{
-	int ii = 0;
-	for(ii = 0; ii < sizeof_w; ii++)
-	printf("%d ",w[ii]);
-	printf("\n");
-}
-
-// Requires: *a : a reference to a non-null big num
-// Modifies: nothing
-// Effects: Prints a 'bignum' (IN HEX)
-void print_bignum(struct bn* a)
-{
-	char buf[4096];
-	bignum_to_string(a, buf, sizeof(buf));
-	printf("bignum (hex) = %s\n", buf);
-}
-
-int check_world(uint32_t w[], int sizeof_w)
-{	
-	// If a given world does not have 2 or more objects, it is automatically
-	//  valid, since there is nothing that can be invalid
-	if(sizeof_w < 2) return 1;
-
-	if(!letter_check(sizeof_w, w))
-		return 0;
-	
-	if(!(location_check_v2(sizeof_w, w)))
-		return 0;
-	
-	return 1;
-}
-
 void test_cases()
 {
 	uint32_t idk[2];
@@ -331,43 +185,1197 @@ void valid_objects_tests(uint32_t v[])
 	}
 }
 
-int main()
+static void write_world(uint32_t w[], const int indices[], int sizeof_w, void* ctx)
+{
+	world_writer_add(ctx, w, indices);
+}
+
+// Effects: Streams every valid world of objects_in_world objects into path
+int dump_level(uint32_t valid_objects[], int objects_in_world, const char* path, enum world_encoding encoding)
+{
+	struct world_writer wr;
+	struct bn count;
+
+	if(objects_in_world < 0 || objects_in_world > MAX_OBJECTS_IN_WORLD)
+	{
+		fprintf(stderr, "objects_in_world must be in 0..%d\n", MAX_OBJECTS_IN_WORLD);
+		return 1;
+	}
+	if(!world_writer_open(&wr, path, objects_in_world, encoding))
+		return 1;
+
+	bignum_init(&count);
+	enumerate_level(valid_objects, objects_in_world, 0, NUM_VALID_OBJECTS, &count, write_world, &wr);
+
+	if(!world_writer_close(&wr))
+		return 1;
+	printf("Worlds of %d objects: \n", objects_in_world);
+	print_bignum(&count);
+	return 0;
+}
+
+// Effects: Prints worlds [first, first + n) of a world file with print_world
+int read_worlds(uint32_t valid_objects[], const char* path, uint64_t first, uint64_t n)
+{
+	struct world_reader rd;
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+
+	if(!world_reader_open(&rd, path, NUM_VALID_OBJECTS))
+		return 1;
+
+	printf("Worlds: %" PRIu64 ", objects in world: %u\n", rd.header->world_count, rd.header->objects_in_world);
+	for(uint64_t i = first; i < first + n && i < rd.header->world_count; i++)
+	{
+		if(!world_reader_get(&rd, i, w, valid_objects))
+		{
+			fprintf(stderr, "%s: world %" PRIu64 " has an object index outside valid_objects\n", path, i);
+			world_reader_close(&rd);
+			return 1;
+		}
+		print_world(w, rd.header->objects_in_world);
+	}
+	world_reader_close(&rd);
+	return 0;
+}
+
+// Effects: Draws n uniform valid worlds of objects_in_world objects, printing them
+//   or streaming them into a packed world file
+int sample_worlds(const struct count_tables* t, int objects_in_world, uint64_t n, uint64_t seed, const char* path)
+{
+	struct world_sampler sampler;
+	struct world_filter f;
+	struct world_writer wr;
+	struct rng r;
+	struct timespec start, end;
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+
+	world_filter_all(&f);
+	sampler_init(&sampler, t, &f);
+	if(objects_in_world < 0 || objects_in_world > MAX_OBJECTS_IN_WORLD || !sampler_can_draw(&sampler, objects_in_world))
+	{
+		fprintf(stderr, "No worlds with %d objects to sample\n", objects_in_world);
+		return 1;
+	}
+	if(path && !world_writer_open(&wr, path, objects_in_world, WORLD_ENCODING_PACKED18))
+		return 1;
+
+	rng_seed(&r, seed, 0);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(uint64_t i = 0; i < n; i++)
+	{
+		sampler_draw(&sampler, &r, objects_in_world, w);
+		if(path)
+			world_writer_add(&wr, w, NULL);
+		else
+			print_world(w, objects_in_world);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if(path && !world_writer_close(&wr))
+		return 1;
+	double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+	fprintf(stderr, "Sampled %" PRIu64 " worlds in %.3f s (%.0f worlds/s)\n", n, secs, secs > 0 ? n / secs : 0);
+	return 0;
+}
+
+// Effects: Evaluates a sentence on one world given as packed objects, or on every
+//   world of a world file, and prints the outcome
+int eval_sentence(uint32_t valid_objects[], const char* text, int nargs, char* args[])
+{
+	struct sentence s;
+	struct eval_world ew;
+	struct world_reader rd;
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+	char err[128];
+
+	if(!sentence_parse(text, &s, err, sizeof(err)))
+	{
+		fprintf(stderr, "Parse error: %s\n", err);
+		return 1;
+	}
+
+	// A single argument that is not a number names a world file
+	if(nargs == 1 && (args[0][0] < '0' || args[0][0] > '9'))
+	{
+		uint64_t counts[3] = { 0, 0, 0 }; // false, true, undefined
+		if(!world_reader_open(&rd, args[0], NUM_VALID_OBJECTS))
+			return 1;
+		int k = rd.header->objects_in_world;
+		struct batch_program prog;
+		bool bad = false;
+		struct world_block* block = malloc(sizeof(*block));
+		if(block && batch_compile(&s, k, &prog))
+		{
+			// 64 worlds at a time through the compiled program
+			world_block_reset(block, k);
+			for(uint64_t i = 0; i < rd.header->world_count; i++)
+			{
+				if((bad = !world_reader_get(&rd, i, w, valid_objects)))
+					break;
+				if(world_block_add(block, w) || i + 1 == rd.header->world_count)
+				{
+					uint64_t truth, undefined;
+					batch_eval(&prog, block, &truth, &undefined);
+					counts[1] += __builtin_popcountll(truth);
+					counts[2] += __builtin_popcountll(undefined);
+					counts[0] += block->num_worlds - __builtin_popcountll(truth | undefined);
+					world_block_reset(block, k);
+				}
+			}
+			batch_program_free(&prog);
+		}
+		else
+		{
+			for(uint64_t i = 0; i < rd.header->world_count; i++)
+			{
+				if((bad = !world_reader_get(&rd, i, w, valid_objects)))
+					break;
+				eval_world_load(&ew, w, k);
+				int v = sentence_eval(&s, &ew);
+				counts[v == SENTENCE_UNDEFINED ? 2 : v]++;
+			}
+		}
+		free(block);
+		world_reader_close(&rd);
+		if(bad)
+		{
+			fprintf(stderr, "%s: object index outside valid_objects\n", args[0]);
+			return 1;
+		}
+		printf("true: %" PRIu64 ", false: %" PRIu64 ", undefined: %" PRIu64 "\n", counts[1], counts[0], counts[2]);
+		return 0;
+	}
+
+	if(nargs > MAX_OBJECTS_IN_WORLD)
+	{
+		fprintf(stderr, "At most %d objects\n", MAX_OBJECTS_IN_WORLD);
+		return 1;
+	}
+	for(int i = 0; i < nargs; i++)
+		w[i] = (uint32_t)strtoul(args[i], NULL, 10);
+	if(!check_world(w, nargs))
+		printf("warning: not a valid world\n");
+	eval_world_load(&ew, w, nargs);
+	int v = sentence_eval(&s, &ew);
+	printf("%s\n", v == SENTENCE_UNDEFINED ? "undefined" : v ? "true" : "false");
+	return 0;
+}
+
+// Effects: Counts the models of a sentence at each level in range ("k" or "lo-hi")
+//   and prints running totals from the low end, like the plain count; writes the
+//   models to world files if path is given
+int models_of(uint32_t valid_objects[], int num_valid_objects, const char* text, const char* range, int threads,
+	const char* path)
+{
+	struct sentence s;
+	struct model_options opt;
+	struct bn counts[MAX_OBJECTS_IN_WORLD + 1];
+	char err[128];
+
+	if(!sentence_parse(text, &s, err, sizeof(err)))
+	{
+		fprintf(stderr, "Parse error: %s\n", err);
+		return 1;
+	}
+
+	opt.min_objects = 0;
+	opt.max_objects = MAX_OBJECTS_IN_WORLD;
+	if(range && sscanf(range, "%d-%d", &opt.min_objects, &opt.max_objects) == 1)
+		opt.max_objects = opt.min_objects;
+	if(opt.min_objects < 0 || opt.max_objects > MAX_OBJECTS_IN_WORLD || opt.min_objects > opt.max_objects)
+	{
+		fprintf(stderr, "objects_in_world must be in 0..%d\n", MAX_OBJECTS_IN_WORLD);
+		return 1;
+	}
+	opt.threads = threads;
+	opt.path = path;
+
+	if(!count_models(valid_objects, num_valid_objects, &s, &opt, counts))
+		return 1;
+
+	// Running totals over the range, as the plain count prints them
+	struct bn total;
+	bignum_init(&total);
+	for(int k = opt.min_objects; k <= opt.max_objects; k++)
+	{
+		bignum_add(&total, &counts[k], &total);
+		printf("Objects in world: %d \n", k);
+		print_bignum(&total);
+	}
+	return 0;
+}
+
+// Effects: Loads one sentence per line of path (blank lines and # comments are
+//   skipped) into a new array. If negated is non-null, a line may start with !
+//   and *negated gets a new array of those flags. Returns the count, -1 on error.
+static int load_sentences(const char* path, struct sentence** out, bool** negated)
+{
+	FILE* f = fopen(path, "r");
+	char line[1024], err[128];
+	struct sentence* list = NULL;
+	bool* flags = NULL;
+	int count = 0, cap = 0, lineno = 0;
+
+	if(!f)
+	{
+		perror(path);
+		return -1;
+	}
+	while(fgets(line, sizeof(line), f))
+	{
+		lineno++;
+		line[strcspn(line, "\r\n")] = 0;
+		if(line[strspn(line, " \t")] == 0 || line[strspn(line, " \t")] == '#')
+			continue;
+		if(count == cap)
+		{
+			cap = cap ? cap * 2 : 16;
+			struct sentence* grown = realloc(list, cap * sizeof(*list));
+			bool* grown_flags = realloc(flags, cap * sizeof(*flags));
+			if(grown)
+				list = grown;
+			if(grown_flags)
+				flags = grown_flags;
+			if(!grown || !grown_flags)
+			{
+				perror("realloc");
+				count = -1;
+				break;
+			}
+		}
+		char* text = line + strspn(line, " \t");
+		flags[count] = negated && *text == '!';
+		if(flags[count])
+			text++;
+		if(!sentence_parse(text, &list[count], err, sizeof(err)))
+		{
+			fprintf(stderr, "%s:%d: %s\n", path, lineno, err);
+			count = -1;
+			break;
+		}
+		count++;
+	}
+	fclose(f);
+	if(count < 0 || !negated)
+		free(flags);
+	if(count < 0)
+		free(list);
+	else
+	{
+		*out = list;
+		if(negated)
+			*negated = flags;
+	}
+	return count;
+}
+
+static const char* value_name(int v)
+{
+	return v == SENTENCE_UNDEFINED ? "undefined" : v ? "true" : "false";
+}
+
+// Effects: Interactive editing of one world against the sentences in path. Reads
+//   commands from stdin and prints the sentences whose value changed:
+//     set <i> <object> | add <object> | remove <i>
+//     move <i> <x> <y> | shape <i> tet|cube|dodec | size <i> small|medium|large
+//     names <i> <letters|->
+//     show
+int edit_world(const char* path, int nargs, char* args[])
+{
+	static const char* shapes[NUM_SHAPES] = { "dodec", "cube", "tet" };
+	static const char* sizes[NUM_SIZES] = { "large", "medium", "small" };
+	struct sentence* sentences = NULL;
+	struct world_editor ed;
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+	char line[256];
+
+	int n = load_sentences(path, &sentences, NULL);
+	if(n < 0)
+		return 1;
+	if(nargs > MAX_OBJECTS_IN_WORLD)
+	{
+		fprintf(stderr, "At most %d objects\n", MAX_OBJECTS_IN_WORLD);
+		free(sentences);
+		return 1;
+	}
+	for(int i = 0; i < nargs; i++)
+		w[i] = (uint32_t)strtoul(args[i], NULL, 10);
+	if(!editor_init(&ed, sentences, n, w, nargs))
+	{
+		free(sentences);
+		return 1;
+	}
+
+	int8_t* before = malloc(n + 1);
+	while(before && fgets(line, sizeof(line), stdin))
+	{
+		char cmd[16], arg[16];
+		unsigned long a = 0, b = 0, c = 0;
+		int fields = sscanf(line, "%15s %lu %15s", cmd, &a, arg);
+		if(fields < 1)
+			continue;
+		sscanf(line, "%*s %lu %lu %lu", &a, &b, &c);
+
+		memcpy(before, ed.values, n);
+		uint32_t o = a < (unsigned long)ed.num_objects ? ed.w[a] : 0;
+		int done = -1;
+		if(!strcmp(cmd, "set"))
+			done = editor_set(&ed, a, b);
+		else if(!strcmp(cmd, "add"))
+			done = editor_add(&ed, a);
+		else if(!strcmp(cmd, "remove"))
+			done = editor_remove(&ed, a);
+		else if(!strcmp(cmd, "move") && b < 8 && c < 8)
+			done = editor_set(&ed, a, (o & ~(63u << 6)) | (uint32_t)((b << 3 | c) << 6));
+		else if(!strcmp(cmd, "shape") && fields == 3)
+		{
+			for(int i = 0; i < NUM_SHAPES; i++)
+				if(!strcmp(arg, shapes[i]))
+					done = editor_set(&ed, a, (o & ~(7u << 12)) | (1u << (12 + i)));
+		}
+		else if(!strcmp(cmd, "size") && fields == 3)
+		{
+			for(int i = 0; i < NUM_SIZES; i++)
+				if(!strcmp(arg, sizes[i]))
+					done = editor_set(&ed, a, (o & ~(7u << 15)) | (1u << (15 + i)));
+		}
+		else if(!strcmp(cmd, "names") && fields == 3)
+		{
+			uint32_t labels = 0;
+			for(const char* p = arg; *p >= 'a' && *p < 'a' + NUM_LABELS; p++)
+				labels |= 1u << (*p - 'a');
+			done = editor_set(&ed, a, (o & ~63u) | labels);
+		}
+		else if(!strcmp(cmd, "show"))
+		{
+			print_world(ed.w, ed.num_objects);
+			for(int i = 0; i < n; i++)
+				printf("%d: %s\n", i, value_name(ed.values[i]));
+			done = 0;
+		}
+
+		if(done < 0)
+		{
+			printf("error\n");
+			fflush(stdout);
+			continue;
+		}
+		for(int i = 0; i < n; i++)
+			if(ed.values[i] != before[i])
+				printf("%d: %s\n", i, value_name(ed.values[i]));
+		printf("%s, re-evaluated %d of %d\n", editor_valid(&ed) ? "valid" : "invalid", done, n);
+		fflush(stdout);
+	}
+
+	free(before);
+	editor_free(&ed);
+	free(sentences);
+	return 0;
+}
+
+// Effects: Searches for up to max_worlds valid worlds where every sentence in path
+//   is true (false for lines starting with !) and prints them
+int solve_sentences(uint32_t valid_objects[], int num_valid_objects, const char* path, int max_worlds,
+	const char* range)
+{
+	struct sentence* sentences = NULL;
+	bool* negated = NULL;
+	struct solve_options opt = { 0, MAX_OBJECTS_IN_WORLD, max_worlds > 0 ? max_worlds : 1 };
+	struct solve_stats stats;
+	struct timespec start, end;
+
+	if(range && sscanf(range, "%d-%d", &opt.min_objects, &opt.max_objects) == 1)
+		opt.max_objects = opt.min_objects;
+	if(opt.min_objects < 0 || opt.max_objects > MAX_OBJECTS_IN_WORLD || opt.min_objects > opt.max_objects)
+	{
+		fprintf(stderr, "objects_in_world must be in 0..%d\n", MAX_OBJECTS_IN_WORLD);
+		return 1;
+	}
+
+	int n = load_sentences(path, &sentences, &negated);
+	if(n < 0)
+		return 1;
+	struct solve_goal* goals = malloc(n * sizeof(*goals) + 1);
+	uint32_t* worlds = malloc(opt.max_worlds * MAX_OBJECTS_IN_WORLD * sizeof(*worlds));
+	int* sizes = malloc(opt.max_worlds * sizeof(*sizes));
+	if(!goals || !worlds || !sizes)
+	{
+		perror("malloc");
+		free(goals);
+		free(worlds);
+		free(sizes);
+		free(sentences);
+		free(negated);
+		return 1;
+	}
+	for(int i = 0; i < n; i++)
+	{
+		goals[i].s = sentences[i];
+		goals[i].want = negated[i] ? SENTENCE_FALSE : SENTENCE_TRUE;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int found = solve_worlds(valid_objects, num_valid_objects, goals, n, &opt, worlds, sizes, &stats);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	for(int i = 0; i < found; i++)
+		print_world(worlds + i * MAX_OBJECTS_IN_WORLD, sizes[i]);
+	double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) * 1e-6;
+	fprintf(stderr, "Found %d world(s) in %.2f ms (%" PRIu64 " assignments, %" PRIu64 " backjumps)\n",
+		found, ms, stats.nodes, stats.backjumps);
+
+	free(goals);
+	free(worlds);
+	free(sizes);
+	free(sentences);
+	free(negated);
+	return found ? 0 : 2;
+}
+
+// Effects: Compiles the valid worlds into a ZDD, optionally keeping only those that
+//   carry every name in names, prints the per-level counts and n samples of k objects
+int zdd_worlds(uint32_t valid_objects[], int num_valid_objects, int k, uint64_t n, uint64_t seed, const char* names)
+{
+	struct zdd z;
+	struct bn counts[MAX_OBJECTS_IN_WORLD + 1], total;
+	struct timespec start, end;
+	struct rng r;
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+
+	if(k < 0 || k > MAX_OBJECTS_IN_WORLD)
+	{
+		fprintf(stderr, "objects_in_world must be in 0..%d\n", MAX_OBJECTS_IN_WORLD);
+		return 1;
+	}
+	uint8_t mask = 0;
+	for(const char* p = names; p && *p; p++)
+	{
+		if(*p < 'a' || *p >= 'a' + NUM_LABELS)
+		{
+			fprintf(stderr, "Bad names: %s (letters a-f only)\n", names);
+			return 1;
+		}
+		mask |= 1 << (*p - 'a');
+	}
+
+	if(!zdd_init(&z, valid_objects, num_valid_objects))
+	{
+		perror("zdd_init");
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int f = zdd_valid_worlds(&z);
+	if(mask)
+		f = zdd_intersect(&z, f, zdd_with_names(&z, mask));
+	bool counted = zdd_count(&z, f, counts);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if(f < 0)
+	{
+		fprintf(stderr, "Could not build the diagram\n");
+		zdd_free(&z);
+		return 1;
+	}
+	if(!counted)
+	{
+		fprintf(stderr, "Could not count the diagram (%d nodes)\n", z.num_nodes);
+		zdd_free(&z);
+		return 1;
+	}
+	fprintf(stderr, "%d nodes in %.3f s\n", z.num_nodes,
+		(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9);
+
+	bignum_init(&total);
+	for(int i = 0; i <= MAX_OBJECTS_IN_WORLD; i++)
+	{
+		bignum_add(&total, &counts[i], &total);
+		printf("Objects in world: %d \n", i);
+		print_bignum(&total);
+	}
+
+	rng_seed(&r, seed, 0);
+	for(uint64_t i = 0; i < n && zdd_sample(&z, f, k, &r, w); i++)
+		print_world(w, k);
+
+	zdd_free(&z);
+	return 0;
+}
+
+// Effects: Counts the valid worlds level by level from the frontier of the level
+//   below, printing the same cumulative totals as the default loop
+int frontier_worlds(uint32_t valid_objects[], int num_valid_objects, int max_objects, double memory_mb)
+{
+	struct frontier_options opt = { max_objects, (size_t)(memory_mb * 1024 * 1024) };
+	struct bn counts[MAX_OBJECTS_IN_WORLD + 1], total;
+	struct frontier_stats stats[MAX_OBJECTS_IN_WORLD + 1];
+	struct timespec start, end;
+
+	if(max_objects < 0 || max_objects > MAX_OBJECTS_IN_WORLD)
+	{
+		fprintf(stderr, "objects_in_world must be in 0..%d\n", MAX_OBJECTS_IN_WORLD);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if(!frontier_count(valid_objects, num_valid_objects, &opt, counts, stats))
+	{
+		fprintf(stderr, "Out of memory or temporary file space\n");
+		return 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	bignum_init(&total);
+	for(int k = 0; k <= max_objects; k++)
+	{
+		bignum_add(&total, &counts[k], &total);
+		printf("Objects in world: %d \n", k);
+		print_bignum(&total);
+		fprintf(stderr, "level %d: %llu states from %llu children, %d runs spilled\n", k,
+			(unsigned long long)stats[k].states, (unsigned long long)stats[k].children, stats[k].runs);
+	}
+	fprintf(stderr, "%.3f s\n", (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9);
+	return 0;
+}
+
+// Effects: Counts one level with the generate/validate/reduce pipeline and reports
+//   how the time of each stage was spent
+int pipeline_worlds(uint32_t valid_objects[], int num_valid_objects, int objects_in_world, int generators, int validators,
+	int block_size)
+{
+	static const char* stage_names[NUM_STAGES] = { "generate", "validate", "reduce" };
+	struct pipeline_options opt = { objects_in_world, generators, validators, block_size, 0 };
+	struct pipeline_stage_stats stats[NUM_STAGES];
+	struct bn count;
+	double wall;
+
+	if(objects_in_world < 0 || objects_in_world > MAX_OBJECTS_IN_WORLD)
+	{
+		fprintf(stderr, "objects_in_world must be in 0..%d\n", MAX_OBJECTS_IN_WORLD);
+		return 1;
+	}
+	if(!pipeline_count(valid_objects, num_valid_objects, &opt, &count, stats, &wall))
+	{
+		fprintf(stderr, "Pipeline setup failed\n");
+		return 1;
+	}
+
+	// One level, not the running total the other modes print under "Objects in world"
+	printf("Worlds of %d objects: \n", objects_in_world);
+	print_bignum(&count);
+	fprintf(stderr, "%.3f s\n", wall);
+	for(int s = 0; s < NUM_STAGES; s++)
+	{
+		double capacity = wall * stats[s].threads;
+		fprintf(stderr, "%-8s %2d threads %10llu blocks  busy %5.1f%%  waiting for input %5.1f%%  for output %5.1f%%\n",
+			stage_names[s], stats[s].threads, (unsigned long long)stats[s].blocks,
+			capacity > 0 ? 100 * stats[s].busy / capacity : 0,
+			capacity > 0 ? 100 * stats[s].wait_in / capacity : 0,
+			capacity > 0 ? 100 * stats[s].wait_out / capacity : 0);
+	}
+	return 0;
+}
+
+// Effects: Prints the dense ID of the world given as objects
+int rank_world(const struct count_tables* t, int nargs, char* args[])
+{
+	struct world_ranker r;
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+	struct bn id;
+	char str[64];
+
+	if(nargs > MAX_OBJECTS_IN_WORLD)
+	{
+		fprintf(stderr, "At most %d objects\n", MAX_OBJECTS_IN_WORLD);
+		return 1;
+	}
+	for(int i = 0; i < nargs; i++)
+	{
+		char* end;
+		errno = 0;
+		unsigned long o = strtoul(args[i], &end, 10);
+		if(errno || end == args[i] || *end || args[i][0] == '-' || o >> 18)
+		{
+			fprintf(stderr, "Not an object: %s\n", args[i]);
+			return 1;
+		}
+		w[i] = (uint32_t)o;
+	}
+
+	ranker_init(&r, t);
+	if(!world_rank(&r, w, nargs, &id))
+	{
+		fprintf(stderr, "Not a valid world\n");
+		return 1;
+	}
+	bignum_to_decimal(&id, str, sizeof(str));
+	printf("%s\n", str);
+	return 0;
+}
+
+// Effects: Prints the n worlds of objects_in_world objects from the decimal ID first on
+int unrank_worlds(const struct count_tables* t, int objects_in_world, const char* first, uint64_t n)
+{
+	struct world_ranker r;
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+	struct bn id, digit, count;
+	char str[64];
+
+	if(objects_in_world < 0 || objects_in_world > MAX_OBJECTS_IN_WORLD)
+	{
+		fprintf(stderr, "bad k: objects_in_world must be in 0..%d\n", MAX_OBJECTS_IN_WORLD);
+		return 1;
+	}
+	ranker_init(&r, t);
+	ranker_count(&r, objects_in_world, &count);
+
+	// IDs only grow digit by digit, so stopping at count(k) also keeps the
+	// bignum from overflowing on long inputs
+	bignum_init(&id);
+	for(const char* p = first; *p || p == first; p++)
+	{
+		if(*p < '0' || *p > '9')
+		{
+			fprintf(stderr, "IDs are decimal\n");
+			return 1;
+		}
+		bignum_mul_int(&id, 10, &id);
+		bignum_from_int(&digit, *p - '0');
+		bignum_add(&id, &digit, &id);
+		if(bignum_cmp(&id, &count) != SMALLER)
+			break;
+	}
+	if(bignum_cmp(&id, &count) != SMALLER)
+	{
+		bignum_to_decimal(&count, str, sizeof(str));
+		fprintf(stderr, "ID out of range: level %d has IDs below %s\n", objects_in_world, str);
+		return 1;
+	}
+
+	for(uint64_t i = 0; i < n && world_unrank(&r, objects_in_world, &id, w); i++)
+	{
+		print_world(w, objects_in_world);
+		bignum_inc(&id);
+	}
+	return 0;
+}
+
+// Effects: Draws n uniform worlds of objects_in_world objects on threads and counts
+//   the distinct ones up to symmetry ("all", "labels", "d4" or "order")
+int dedup_worlds(const struct count_tables* t, int objects_in_world, uint64_t n, int threads, uint64_t seed,
+	const char* symmetry, uint64_t max_entries)
+{
+	struct world_sampler sampler;
+	struct world_filter f;
+	struct canon_set set;
+	struct dedup_stats st;
+	unsigned sym = CANON_ALL;
+
+	if(symmetry && !strcmp(symmetry, "labels"))
+		sym = CANON_LABELS;
+	else if(symmetry && !strcmp(symmetry, "d4"))
+		sym = CANON_D4;
+	else if(symmetry && !strcmp(symmetry, "order"))
+		sym = CANON_ORDER;
+	else if(symmetry && strcmp(symmetry, "all"))
+	{
+		fprintf(stderr, "symmetry is all, labels, d4 or order\n");
+		return 1;
+	}
+
+	world_filter_all(&f);
+	sampler_init(&sampler, t, &f);
+	if(objects_in_world < 0 || objects_in_world > MAX_OBJECTS_IN_WORLD || !sampler_can_draw(&sampler, objects_in_world))
+	{
+		fprintf(stderr, "No worlds with %d objects to sample\n", objects_in_world);
+		return 1;
+	}
+	if(!max_entries)
+		max_entries = n;
+	if(!canon_set_init(&set, max_entries))
+	{
+		fprintf(stderr, "Cannot allocate a set of %" PRIu64 " fingerprints\n", max_entries);
+		return 1;
+	}
+	bool ok = canon_dedup_sampled(&sampler, objects_in_world, n, threads, seed, sym, &set, &st);
+	canon_set_free(&set);
+	if(!ok)
+		return 1;
+
+	printf("Drawn: %" PRIu64 "  distinct: %" PRIu64 "  duplicates: %" PRIu64 "  refused (full): %" PRIu64 "\n",
+		st.drawn, st.distinct, st.duplicates, st.refused);
+	fprintf(stderr, "%.3f s (%.0f worlds/s), set of %" PRIu64 " slots (%.1f MiB)\n", st.seconds,
+		st.seconds > 0 ? st.drawn / st.seconds : 0, canon_set_capacity(max_entries),
+		canon_set_capacity(max_entries) * sizeof(struct canon_slot) / 1048576.0);
+	return 0;
+}
+
+// Effects: Prints one row of the --perf table
+static void print_perf_row(const char* phase, int k, uint64_t accepted, const struct perf_sample* d)
+{
+	printf("%-19s %2d %12" PRIu64 " %9.4f", phase, k, accepted, d->seconds);
+	for(int e = 0; e < PERF_NUM_EVENTS; e++)
+	{
+		if(d->valid[e])
+			printf(" %14" PRIu64, d->value[e]);
+		else
+			printf(" %14s", "-");
+	}
+	if(d->valid[PERF_CYCLES] && d->valid[PERF_INSTRUCTIONS] && d->value[PERF_CYCLES])
+		printf(" %5.2f", (double)d->value[PERF_INSTRUCTIONS] / d->value[PERF_CYCLES]);
+	else
+		printf(" %5s", "-");
+	printf("\n");
+}
+
+// Most random worlds perf_worlds can hold without n * MAX_OBJECTS_IN_WORLD words
+// overflowing size_t
+#define PERF_MAX_WORLDS (SIZE_MAX / (MAX_OBJECTS_IN_WORLD * sizeof(uint32_t)))
+
+// Effects: Measures each level of count_level_by_cell up to max_objects, then letter_check,
+//   location_check_v2 and the check kernel of every size on the same n random
+//   worlds, under the hardware counters where the system grants them
+int perf_worlds(uint32_t valid_objects[], int max_objects, uint64_t n)
+{
+	struct perf_counters p;
+	struct perf_sample before, after, d;
+	uint32_t pool[NUM_SIZES * NUM_SHAPES * NUM_CELLS];
+	int num_pool = 0;
+	struct rng r;
+
+	if(max_objects < 0 || max_objects > MAX_OBJECTS_IN_WORLD || n == 0 || n > PERF_MAX_WORLDS)
+	{
+		fprintf(stderr, "objects_in_world must be in 0..%d, worlds in 1..%" PRIu64 "\n", MAX_OBJECTS_IN_WORLD,
+			(uint64_t)PERF_MAX_WORLDS);
+		return 1;
+	}
+	uint32_t* worlds = malloc(n * MAX_OBJECTS_IN_WORLD * sizeof(*worlds));
+	if(!worlds)
+	{
+		perror("malloc");
+		return 1;
+	}
+	if(!perf_open(&p))
+		fprintf(stderr, "Hardware counters unavailable (%s); timing only\n", strerror(p.error));
+
+	printf("%-19s %2s %12s %9s", "phase", "k", "accepted", "seconds");
+	for(int e = 0; e < PERF_NUM_EVENTS; e++)
+		printf(" %14s", perf_event_name(e));
+	printf(" %5s\n", "IPC");
+
+	for(int k = 1; k <= max_objects; k++)
+	{
+		struct bn count;
+		bignum_init(&count);
+		perf_read(&p, &before);
+		count_level_by_cell(k, 0, NUM_VALID_OBJECTS, &count);
+		perf_read(&p, &after);
+		perf_diff(&before, &after, &d);
+		// Only the low 64 bits fit the column
+		print_perf_row("count_level_by_cell", k, bignum_low64(&count), &d);
+	}
+
+	// Unnamed objects of every size, large ones included, so the checks get past
+	// the names to the location tests
+	for(int size = 0; size < NUM_SIZES; size++)
+		for(int shape = 0; shape < NUM_SHAPES; shape++)
+			for(int cell = 0; cell < NUM_CELLS; cell++)
+				pool[num_pool++] = (1 << (15 + size)) | (1 << (12 + shape)) | (cell << 6);
+
+	rng_seed(&r, 1, 0);
+	for(int k = 2; k <= MAX_OBJECTS_IN_WORLD; k++)
+	{
+		for(uint64_t i = 0; i < n * k; i++)
+			worlds[i] = pool[rng_below(&r, num_pool)];
+
+		uint64_t accepted = 0;
+		perf_read(&p, &before);
+		for(uint64_t i = 0; i < n; i++)
+			accepted += letter_check(k, worlds + i * k);
+		perf_read(&p, &after);
+		perf_diff(&before, &after, &d);
+		print_perf_row("letter_check", k, accepted, &d);
+
+		accepted = 0;
+		perf_read(&p, &before);
+		for(uint64_t i = 0; i < n; i++)
+			accepted += location_check_v2(k, worlds + i * k);
+		perf_read(&p, &after);
+		perf_diff(&before, &after, &d);
+		print_perf_row("location_check_v2", k, accepted, &d);
+
+		check_kernel check = check_kernels[k];
+		accepted = 0;
+		perf_read(&p, &before);
+		for(uint64_t i = 0; i < n; i++)
+			accepted += check(worlds + i * k);
+		perf_read(&p, &after);
+		perf_diff(&before, &after, &d);
+		print_perf_row("check kernel", k, accepted, &d);
+	}
+
+	perf_close(&p);
+	free(worlds);
+	return 0;
+}
+
+// Effects: Prints the number of valid worlds matching conditions dim=value, or
+//   with by=dim their distribution over that dimension. Dimensions: k, dodec,
+//   cube, tet, large, medium, small, names.
+int dist_worlds(const struct count_tables* t, int nargs, char* args[])
+{
+	static const char* dims[] = { "k", "dodec", "cube", "tet", "large", "medium", "small", "names" };
+	enum { NUM_DIMS = sizeof(dims) / sizeof(dims[0]) };
+	struct dist_query q;
+	int* fields[NUM_DIMS];
+	int by = -1;
+	char str[128];
+	struct bn count;
+
+	dist_query_any(&q);
+	fields[0] = &q.objects;
+	for(int i = 0; i < NUM_SHAPES; i++)
+		fields[1 + i] = &q.shapes[i];
+	for(int i = 0; i < NUM_SIZES; i++)
+		fields[1 + NUM_SHAPES + i] = &q.sizes[i];
+	fields[NUM_DIMS - 1] = &q.names;
+
+	for(int a = 0; a < nargs; a++)
+	{
+		char* eq = strchr(args[a], '=');
+		int dim = -1;
+		for(int i = 0; eq && i < NUM_DIMS; i++)
+			if(strlen(dims[i]) == (size_t)(eq - args[a]) && !strncmp(args[a], dims[i], eq - args[a]))
+				dim = i;
+		if(eq && !strncmp(args[a], "by=", 3))
+		{
+			for(int i = 0; i < NUM_DIMS; i++)
+				if(!strcmp(eq + 1, dims[i]))
+					by = i;
+			if(by < 0)
+				dim = -1;
+			else
+				continue;
+		}
+		if(dim < 0)
+		{
+			fprintf(stderr, "Expected dim=value or by=dim, dim one of k dodec cube tet large medium small names\n");
+			return 1;
+		}
+		char* end;
+		int max = dim == NUM_DIMS - 1 ? NUM_LABELS : MAX_OBJECTS_IN_WORLD;
+		errno = 0;
+		long v = strtol(eq + 1, &end, 10);
+		if(errno || end == eq + 1 || *end || v < 0 || v > max)
+		{
+			fprintf(stderr, "%s must be a number in 0..%d\n", dims[dim], max);
+			return 1;
+		}
+		*fields[dim] = (int)v;
+	}
+
+	struct world_dist* d = malloc(sizeof(*d));
+	if(!d)
+	{
+		perror("malloc");
+		return 1;
+	}
+	dist_build(d, t);
+	if(by < 0)
+	{
+		dist_count(d, &q, &count);
+		bignum_to_decimal(&count, str, sizeof(str));
+		printf("%s\n", str);
+	}
+	else
+	{
+		int max = by == NUM_DIMS - 1 ? NUM_LABELS : by > 0 && q.objects != DIST_ANY ? q.objects : MAX_OBJECTS_IN_WORLD;
+		for(int v = 0; v <= max; v++)
+		{
+			*fields[by] = v;
+			dist_count(d, &q, &count);
+			bignum_to_decimal(&count, str, sizeof(str));
+			printf("%s=%d\t%s\n", dims[by], v, str);
+		}
+	}
+	free(d);
+	return 0;
+}
+
+// Effects: Counts one level through the S6 orbits of its worlds and reports how
+//   many canonical worlds that took
+int orbit_worlds(uint32_t valid_objects[], int num_valid_objects, int objects_in_world, int first_lead, int last_lead)
+{
+	struct timespec start, end;
+	struct bn count;
+	uint64_t canonical = 0;
+
+	if(objects_in_world < 0 || objects_in_world > MAX_OBJECTS_IN_WORLD)
+	{
+		fprintf(stderr, "objects_in_world must be in 0..%d\n", MAX_OBJECTS_IN_WORLD);
+		return 1;
+	}
+	bignum_init(&count);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if(!orbit_enumerate(valid_objects, num_valid_objects, objects_in_world, first_lead, last_lead, &count, &canonical,
+		NULL, NULL))
+	{
+		fprintf(stderr, "valid_objects does not have every label mask on every body\n");
+		return 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	// The level (or lead range) alone, so not under the running totals' header
+	printf("Worlds of %d objects: \n", objects_in_world);
+	print_bignum(&count);
+	double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+	fprintf(stderr, "%" PRIu64 " canonical worlds in %.3f s\n", canonical, secs);
+	return 0;
+}
+
+// Effects: *v = arg, a decimal integer in [min, max]. Returns false, after saying
+//   what was expected, if arg is anything else.
+static bool parse_int_arg(const char* arg, const char* what, int min, int max, int* v)
+{
+	char* end;
+	errno = 0;
+	long x = strtol(arg, &end, 10);
+	if(errno || end == arg || *end || x < min || x > max)
+	{
+		fprintf(stderr, "%s must be a number in %d..%d\n", what, min, max);
+		return false;
+	}
+	*v = (int)x;
+	return true;
+}
+
+// Effects: As parse_int_arg, for an unsigned 64-bit integer in [min, max]
+static bool parse_u64_arg(const char* arg, const char* what, uint64_t min, uint64_t max, uint64_t* v)
+{
+	char* end;
+	errno = 0;
+	unsigned long long x = strtoull(arg, &end, 10);
+	if(errno || end == arg || *end || arg[0] == '-' || x < min || x > max)
+	{
+		fprintf(stderr, "%s must be a number in %" PRIu64 "..%" PRIu64 "\n", what, min, max);
+		return false;
+	}
+	*v = x;
+	return true;
+}
+
+// Effects: As parse_int_arg, for a real number
+static bool parse_double_arg(const char* arg, const char* what, double min, double max, double* v)
+{
+	char* end;
+	errno = 0;
+	double x = strtod(arg, &end);
+	if(errno || end == arg || *end || !(x >= min && x <= max))
+	{
+		fprintf(stderr, "%s must be a number in %.10g..%.10g\n", what, min, max);
+		return false;
+	}
+	*v = x;
+	return true;
+}
+
+// A mode that needs the closed-form counting tables, given main's arguments
+typedef int (*table_mode)(const struct count_tables* t, int argc, char* argv[]);
+
+// Effects: Runs fn on the cached counting tables and releases them. Returns fn's
+//   status, or 1 if the tables cannot be had.
+static int with_count_tables(table_mode fn, int argc, char* argv[])
+{
+	struct table_cache cache;
+
+	if(!table_cache_load(&cache))
+		return 1;
+	int status = 1;
+	if(table_cache_tables(&cache))
+		status = fn(table_cache_tables(&cache), argc, argv);
+	else
+		fprintf(stderr, "valid_objects has no closed-form counting tables\n");
+	table_cache_release(&cache);
+	return status;
+}
+
+static int serve_mode(const struct count_tables* t, int argc, char* argv[])
+{
+	return run_query_server(t, argc >= 3 ? argv[2] : NULL);
+}
+
+static int rank_mode(const struct count_tables* t, int argc, char* argv[])
+{
+	return rank_world(t, argc - 2, argv + 2);
+}
+
+static int unrank_mode(const struct count_tables* t, int argc, char* argv[])
+{
+	return unrank_worlds(t, atoi(argv[2]), argv[3], argc >= 5 ? strtoull(argv[4], NULL, 10) : 1);
+}
+
+static int sample_mode(const struct count_tables* t, int argc, char* argv[])
+{
+	return sample_worlds(t, atoi(argv[2]), strtoull(argv[3], NULL, 10),
+		argc >= 5 ? strtoull(argv[4], NULL, 10) : 1, argc >= 6 ? argv[5] : NULL);
+}
+
+static int dedup_mode(const struct count_tables* t, int argc, char* argv[])
+{
+	return dedup_worlds(t, atoi(argv[2]), strtoull(argv[3], NULL, 10),
+		argc >= 5 ? atoi(argv[4]) : 0, argc >= 6 ? strtoull(argv[5], NULL, 10) : 1,
+		argc >= 7 ? argv[6] : NULL, argc >= 8 ? strtoull(argv[7], NULL, 10) : 0);
+}
+
+static int dist_mode(const struct count_tables* t, int argc, char* argv[])
+{
+	return dist_worlds(t, argc - 2, argv + 2);
+}
+
+int main(int argc, char* argv[])
 {
 	//test_cases();
 
-	int s, m, l, t, c, d, i, j;
-	int size;
+	int j;
 	
 	// Generation of valid objects
 	uint32_t valid_objects[NUM_VALID_OBJECTS];
 
-	//i = 0;
-	j = 0;
+	// Multi-process modes:
+	//   tarski --coordinator [workers] [max_objects] [socket]
+	//   tarski --worker <socket>
+	if(argc >= 3 && !strcmp(argv[1], "--worker"))
+		return run_worker(argv[2]);
+	if(argc >= 2 && !strcmp(argv[1], "--coordinator"))
+		return run_coordinator(argc >= 3 ? atoi(argv[2]) : 0,
+			argc >= 4 ? atoi(argv[3]) : MAX_OBJECTS_IN_WORLD,
+			argc >= 5 ? argv[4] : NULL);
+
+	// Query daemon: tarski --serve [socket] (stdin/stdout without a socket)
+	if(argc >= 2 && !strcmp(argv[1], "--serve"))
+		return with_count_tables(serve_mode, argc, argv);
+
+	// Dense world IDs: tarski --rank <object>... | tarski --unrank <objects_in_world> <id> [count]
+	if(argc >= 2 && !strcmp(argv[1], "--rank"))
+		return with_count_tables(rank_mode, argc, argv);
+	if(argc >= 4 && !strcmp(argv[1], "--unrank"))
+		return with_count_tables(unrank_mode, argc, argv);
+
+	// Breakdowns: tarski --dist [dim=value]... [by=dim]
+	if(argc >= 2 && !strcmp(argv[1], "--dist"))
+		return with_count_tables(dist_mode, argc, argv);
+
+	// Uniform sampling: tarski --sample <objects_in_world> <n> [seed] [file]
+	if(argc >= 4 && !strcmp(argv[1], "--sample"))
+		return with_count_tables(sample_mode, argc, argv);
+
+	// Deduplication up to symmetry:
+	//   tarski --dedup <objects_in_world> <n> [threads] [seed] [all|labels|d4|order] [max_entries]
+	if(argc >= 4 && !strcmp(argv[1], "--dedup"))
+		return with_count_tables(dedup_mode, argc, argv);
+
+	j = generate_valid_objects(valid_objects);
+
+	// Binary world files:
+	//   tarski --dump <objects_in_world> <file> [packed|index]
+	//   tarski --read <file> [first] [count]
+	if(argc >= 4 && !strcmp(argv[1], "--dump"))
+		return dump_level(valid_objects, atoi(argv[2]), argv[3],
+			argc >= 5 && !strcmp(argv[4], "index") ? WORLD_ENCODING_INDEX16 : WORLD_ENCODING_PACKED18);
+	if(argc >= 3 && !strcmp(argv[1], "--read"))
+		return read_worlds(valid_objects, argv[2],
+			argc >= 4 ? strtoull(argv[3], NULL, 10) : 0,
+			argc >= 5 ? strtoull(argv[4], NULL, 10) : 10);
 
-	// Goes through all potential objects (all 18 digit numbers)
-	for(i = 0; i <= 262143; i++)
+	// Sentence evaluation: tarski --eval <sentence> (<world file> | <object>...)
+	if(argc >= 3 && !strcmp(argv[1], "--eval"))
+		return eval_sentence(valid_objects, argv[2], argc - 3, argv + 3);
+
+	// Incremental checking: tarski --edit <sentence file> [object...]
+	if(argc >= 3 && !strcmp(argv[1], "--edit"))
+		return edit_world(argv[2], argc - 3, argv + 3);
+
+	// World search: tarski --solve <sentence file> [n] [k|lo-hi]
+	if(argc >= 3 && !strcmp(argv[1], "--solve"))
+		return solve_sentences(valid_objects, j, argv[2], argc >= 4 ? atoi(argv[3]) : 1, argc >= 5 ? argv[4] : NULL);
+
+	// Hardware counter profile: tarski --perf [max_objects] [worlds]
+	if(argc >= 2 && !strcmp(argv[1], "--perf"))
 	{
-		// Isolates the relevant bit to each possible size or shape
-		//  Sizes: {Small, Medium, Large}
-		//  Shapes: {Tetrahedron, Cube, Dodecahedron}
-		s = (i >> 17) & 1;
-		m = (i >> 16) & 1;
-		l = (i >> 15) & 1;
-		t = (i >> 14) & 1;
-		c = (i >> 13) & 1;
-		d = (i >> 12) & 1;
+		int max_objects = 3;
+		uint64_t n = 1 << 20;
+		if((argc >= 3 && !parse_int_arg(argv[2], "max_objects", 0, MAX_OBJECTS_IN_WORLD, &max_objects))
+			|| (argc >= 4 && !parse_u64_arg(argv[3], "worlds", 1, PERF_MAX_WORLDS, &n)))
+			return 1;
+		return perf_worlds(valid_objects, max_objects, n);
+	}
 
-		if(l) continue;
-		
-		// Ensures only 1 size and shape bit is on for any given valid object
-		if(!((s ^ m) ^ l) ^ (s & m & l))
-			continue;
-		if(!((t ^ c) ^ d) ^ (t & c & d)) 
-			continue;
-		
-		// Any object that has met these requirements is valid, and can be added to the array
-		valid_objects[j] = i;
-		j++;
+	// Name orbits: tarski --orbits <objects_in_world> [first_lead] [last_lead] (leads index bodies)
+	if(argc >= 3 && !strcmp(argv[1], "--orbits"))
+	{
+		int objects_in_world, first_lead = 0, last_lead = NUM_VALID_OBJECTS;
+		if(!parse_int_arg(argv[2], "objects_in_world", 0, MAX_OBJECTS_IN_WORLD, &objects_in_world)
+			|| (argc >= 4 && !parse_int_arg(argv[3], "first_lead", 0, NUM_VALID_OBJECTS, &first_lead))
+			|| (argc >= 5 && !parse_int_arg(argv[4], "last_lead", 0, NUM_VALID_OBJECTS, &last_lead)))
+			return 1;
+		return orbit_worlds(valid_objects, j, objects_in_world, first_lead, last_lead);
+	}
+
+	// Pipelined counting: tarski --pipeline <objects_in_world> [generators] [validators] [block size]
+	//   (0 threads or block size = the defaults of struct pipeline_options)
+	if(argc >= 3 && !strcmp(argv[1], "--pipeline"))
+	{
+		int objects_in_world, generators = 0, validators = 0, block_size = 0;
+		if(!parse_int_arg(argv[2], "objects_in_world", 0, MAX_OBJECTS_IN_WORLD, &objects_in_world)
+			|| (argc >= 4 && !parse_int_arg(argv[3], "generators", 0, 1024, &generators))
+			|| (argc >= 5 && !parse_int_arg(argv[4], "validators", 0, 1024, &validators))
+			|| (argc >= 6 && !parse_int_arg(argv[5], "block size", 0, 1 << 20, &block_size)))
+			return 1;
+		return pipeline_worlds(valid_objects, j, objects_in_world, generators, validators, block_size);
+	}
+
+	// Breadth-first counting: tarski --frontier [objects_in_world] [memory MiB]
+	if(argc >= 2 && !strcmp(argv[1], "--frontier"))
+	{
+		int max_objects = MAX_OBJECTS_IN_WORLD;
+		double memory_mb = 256;
+		if((argc >= 3 && !parse_int_arg(argv[2], "objects_in_world", 0, MAX_OBJECTS_IN_WORLD, &max_objects))
+			|| (argc >= 4 && !parse_double_arg(argv[3], "memory MiB", 1, 1 << 20, &memory_mb)))
+			return 1;
+		return frontier_worlds(valid_objects, j, max_objects, memory_mb);
+	}
+
+	// Decision diagram: tarski --zdd [k] [samples] [seed] [names]
+	if(argc >= 2 && !strcmp(argv[1], "--zdd"))
+		return zdd_worlds(valid_objects, j, argc >= 3 ? atoi(argv[2]) : 0, argc >= 4 ? strtoull(argv[3], NULL, 10) : 0,
+			argc >= 5 ? strtoull(argv[4], NULL, 10) : 1, argc >= 6 ? argv[5] : NULL);
+
+	// Model counting: tarski --models <sentence> [k|lo-hi] [threads] [file]
+	if(argc >= 3 && !strcmp(argv[1], "--models"))
+		return models_of(valid_objects, j, argv[2], argc >= 4 ? argv[3] : NULL,
+			argc >= 5 ? atoi(argv[4]) : 0, argc >= 6 ? argv[5] : NULL);
+
+	// Monte Carlo estimate:
+	//   tarski --estimate <objects_in_world> [rel_error] [threads] [seed] [sis|uniform] [max_samples]
+	if(argc >= 3 && !strcmp(argv[1], "--estimate"))
+	{
+		struct estimate_options opt;
+		struct estimate_result result;
+
+		estimate_options_default(&opt, atoi(argv[2]));
+		if(argc >= 4) opt.rel_error = atof(argv[3]);
+		if(argc >= 5) opt.threads = atoi(argv[4]);
+		if(argc >= 6) opt.seed = strtoull(argv[5], NULL, 10);
+		if(argc >= 7) opt.method = strcmp(argv[6], "uniform") ? ESTIMATE_SIS : ESTIMATE_UNIFORM;
+		if(argc >= 8) opt.max_samples = strtoull(argv[7], NULL, 10);
+		if(opt.objects_in_world < 0 || opt.objects_in_world > MAX_OBJECTS_IN_WORLD)
+		{
+			fprintf(stderr, "objects_in_world must be in 0..%d\n", MAX_OBJECTS_IN_WORLD);
+			return 1;
+		}
+		if(!estimate_worlds(valid_objects, j, &opt, &result))
+			return 1;
+		print_estimate(&opt, &result);
+		return 0;
 	}
 	
 	//valid_objects_tests(valid_objects);
@@ -382,60 +1390,7 @@ int main()
 
 	for(int objects_in_world = 0; objects_in_world <= MAX_OBJECTS_IN_WORLD; objects_in_world++)
 	{
-		int indices[NUM_VALID_OBJECTS];
-		int y = 0;
-
-		// Indicies correspond to their respective object in the world (max size 12)
-		for(int a = 0; a < objects_in_world; a++) // Keeps track of track of which are which in the choose - i.e. first object is valid object 5
-			indices[a] = a;
-		
-		uint32_t temp_world[objects_in_world]; //size k
-		
-		for(y = 0; y < objects_in_world; y++) // Create a world using a combination of the world (in this case, valid objects 1,2,...n)
-			temp_world[y] = valid_objects[indices[y]];
-		
-		bool overflow_check = false;
-		
-		if(check_world(temp_world, objects_in_world))
-			bignum_inc(&final_count);
-		
-		while(true)
-		{
-			bool successful_loop = true;
-
-			// Since we start from the last object, we will increment the first element last
-			for(y = objects_in_world-1; y >= 0; y--) // Checks if we have done all combination possibilities, y being a respective object in the last world
-			{
-			    // All of the objects need to correspond to the last possible combination (last_possible_index - NUM, lpi - (NUM - 1), ... lpi)
-				if(indices[y] != y + NUM_VALID_OBJECTS - objects_in_world) 
-				{
-					successful_loop = false;
-					break;
-				}
-			}
-
-			// If the last world we tested was last possible configuration
-			if(successful_loop)
-				break;
-
-			// This will not run on the last combination, so no need to worry about -1 index (because the last one we successfully run through all configurations)
-			// Increment the last object not in the last config spot (i.e. 1,2,3 (36864 max objects) -> 2,2,3 (we will update the other ones in the other for loop))
-			indices[y] += 1;
-
-			// Increment the other obejects so they are one above the element we incremented before
-			// If we have moved on to the next element (i.e. left of the last object), this also resets the objects after it, we can increment those again
-			for(int z = y+1; z < objects_in_world; z++) 
-				indices[z] = indices[z-1] + 1;
-
-			// World generation using our new combination of valid objects
-			uint32_t temp_world_2[objects_in_world];
-			
-			for(y = 0; y < objects_in_world; y++)
-				temp_world_2[y] = valid_objects[indices[y]];
-			
-			if(check_world(temp_world_2, objects_in_world))
-				bignum_inc(&final_count);
-		}
+		count_level_by_cell(objects_in_world, 0, NUM_VALID_OBJECTS, &final_count);
 		printf("Objects in world: %d \n",objects_in_world);
 		print_bignum(&final_count);
 	}
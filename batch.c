@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "tarski.h"
+#include "count.h"
+#include "sentence.h"
+#include "spatial.h"
+#include "batch.h"
+
+struct compiler
+{
+	const struct sentence* s;
+	struct batch_program* p;
+	int cap;
+	bool overflow;
+};
+
+// Returns: index of a new instruction, or -1 once the program is too long
+static int emit(struct compiler* c, struct batch_insn insn)
+{
+	if(c->p->num_insns == BATCH_MAX_INSNS)
+	{
+		c->overflow = true;
+		return -1;
+	}
+	if(c->p->num_insns == c->cap)
+	{
+		int cap = c->cap ? c->cap * 2 : 64;
+		struct batch_insn* insns = realloc(c->p->insns, cap * sizeof(*insns));
+		if(!insns)
+		{
+			c->overflow = true;
+			return -1;
+		}
+		c->p->insns = insns;
+		c->cap = cap;
+	}
+	c->p->insns[c->p->num_insns] = insn;
+	return c->p->num_insns++;
+}
+
+static int emit_const(struct compiler* c, bool v)
+{
+	return emit(c, (struct batch_insn){ .op = BATCH_CONST, .a = v });
+}
+
+// Effects: If the body of quantifier q is a spatial atom, or its negation, with the
+//   bound variable in one argument, fills *insn with the occupancy test for it
+static bool cells_insn(struct compiler* c, const struct sentence_node* q, const uint8_t env[], struct batch_insn* insn)
+{
+	const struct sentence_node* atom = &c->s->nodes[q->left];
+	bool negated = atom->op == OP_NOT;
+	int var = TERM_VAR + q->var;
+	int var_pos = -1, num_other = 0;
+
+	if(negated)
+		atom = &c->s->nodes[atom->left];
+	if(atom->op != OP_ATOM || !spatial_pred(atom->pred))
+		return false;
+
+	*insn = (struct batch_insn){ .op = q->op == OP_FORALL ? BATCH_FORALL_CELLS : BATCH_EXISTS_CELLS, .pred = atom->pred };
+	for(int i = 0; i < (atom->pred == PRED_BETWEEN ? 3 : 2); i++)
+	{
+		int t = atom->arg[i];
+		if(t == var)
+		{
+			if(var_pos >= 0)
+				return false;
+			var_pos = i;
+		}
+		else
+			insn->slot[num_other++] = t >= TERM_VAR ? env[t - TERM_VAR] : BATCH_NAME_SLOT + t;
+	}
+	insn->a = var_pos;
+	insn->b = negated;
+	return var_pos >= 0;
+}
+
+static int compile_node(struct compiler* c, int n, uint8_t env[])
+{
+	const struct sentence_node* node = &c->s->nodes[n];
+	int k = c->p->objects_in_world;
+	int l, r;
+
+	if(c->overflow)
+		return -1;
+
+	switch(node->op)
+	{
+		case OP_ATOM:
+		{
+			struct batch_insn insn = { .op = BATCH_ATOM, .pred = node->pred };
+			for(int i = 0; i < 3; i++)
+				insn.slot[i] = node->arg[i] >= TERM_VAR ? env[node->arg[i] - TERM_VAR] : BATCH_NAME_SLOT + node->arg[i];
+			// Identity of two object slots is known now
+			if(node->pred == PRED_EQUAL && insn.slot[0] < BATCH_NAME_SLOT && insn.slot[1] < BATCH_NAME_SLOT)
+				return emit_const(c, insn.slot[0] == insn.slot[1]);
+			return emit(c, insn);
+		}
+		case OP_NOT:
+			l = compile_node(c, node->left, env);
+			return emit(c, (struct batch_insn){ .op = BATCH_NOT, .a = l });
+		case OP_AND:
+		case OP_OR:
+		case OP_IMPLIES:
+		case OP_IFF:
+			l = compile_node(c, node->left, env);
+			r = compile_node(c, node->right, env);
+			return emit(c, (struct batch_insn){ .op = BATCH_AND + (node->op - OP_AND), .a = l, .b = r });
+		case OP_FORALL:
+		case OP_EXISTS:
+		{
+			uint8_t op = node->op == OP_FORALL ? BATCH_AND : BATCH_OR;
+			struct batch_insn insn;
+			if(k == 0)
+				return emit_const(c, node->op == OP_FORALL);
+			if(cells_insn(c, node, env, &insn))
+				return emit(c, insn);
+			env[node->var] = 0;
+			l = compile_node(c, node->left, env);
+			for(int slot = 1; slot < k; slot++)
+			{
+				env[node->var] = slot;
+				r = compile_node(c, node->left, env);
+				l = emit(c, (struct batch_insn){ .op = op, .a = l, .b = r });
+			}
+			return l;
+		}
+	}
+	return -1;
+}
+
+bool batch_compile(const struct sentence* s, int objects_in_world, struct batch_program* p)
+{
+	struct compiler c = { s, p, 0, false };
+	uint8_t env[SENTENCE_MAX_VARS];
+
+	memset(p, 0, sizeof(*p));
+	p->objects_in_world = objects_in_world;
+	p->names = s->names;
+	compile_node(&c, s->root, env);
+	if(!c.overflow)
+		p->regs = malloc(p->num_insns * sizeof(*p->regs));
+	if(c.overflow || !p->regs)
+	{
+		batch_program_free(p);
+		return false;
+	}
+	return true;
+}
+
+void batch_program_free(struct batch_program* p)
+{
+	free(p->insns);
+	free(p->regs);
+	p->insns = NULL;
+	p->regs = NULL;
+	p->num_insns = 0;
+}
+
+void world_block_reset(struct world_block* b, int objects_in_world)
+{
+	b->objects_in_world = objects_in_world;
+	b->num_worlds = 0;
+}
+
+bool world_block_add(struct world_block* b, const uint32_t w[])
+{
+	int lane = b->num_worlds++;
+	uint8_t names = 0;
+	uint64_t occupied = 0;
+
+	for(int n = 0; n < NUM_LABELS; n++)
+		b->id[BATCH_NAME_SLOT + n][lane] = BATCH_NO_OBJECT;
+
+	for(int i = 0; i < b->objects_in_world; i++)
+	{
+		uint32_t o = w[i];
+		uint8_t cell = OBJECT_CELL(o);
+		b->worlds[lane][i] = o;
+		b->x[i][lane] = CELL_X(cell);
+		b->y[i][lane] = CELL_Y(cell);
+		b->shape[i][lane] = OBJECT_SHAPE(o) ? __builtin_ctz(OBJECT_SHAPE(o)) : 0;
+		b->size_rank[i][lane] = OBJECT_SIZE(o) ? 2 - __builtin_ctz(OBJECT_SIZE(o)) : 0;
+		b->id[i][lane] = i;
+		for(uint8_t labels = OBJECT_LABELS(o); labels; labels &= labels - 1)
+		{
+			int slot = BATCH_NAME_SLOT + __builtin_ctz(labels);
+			b->x[slot][lane] = b->x[i][lane];
+			b->y[slot][lane] = b->y[i][lane];
+			b->shape[slot][lane] = b->shape[i][lane];
+			b->size_rank[slot][lane] = b->size_rank[i][lane];
+			b->id[slot][lane] = i;
+		}
+		names |= OBJECT_LABELS(o);
+		occupied |= 1ULL << cell;
+	}
+	b->names[lane] = names;
+	b->occupied[lane] = occupied;
+	return b->num_worlds == BATCH_LANES;
+}
+
+// Returns: bit i set where lane i of r is 0xFF (lanes are 0 or 0xFF)
+static inline uint64_t lane_mask(const uint8_t r[BATCH_LANES])
+{
+	uint64_t m = 0;
+#ifdef __SSE2__
+	for(int i = 0; i < BATCH_LANES; i += 16)
+		m |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(r + i))) << i;
+#else
+	for(int i = 0; i < BATCH_LANES; i++)
+		m |= (uint64_t)(r[i] & 1) << i;
+#endif
+	return m;
+}
+
+// One comparison over every lane; written so the compiler vectorizes the loop
+#define LANES(expr) \
+	do { \
+		for(int i = 0; i < BATCH_LANES; i++) \
+			r[i] = (expr) ? 0xFF : 0; \
+		return lane_mask(r); \
+	} while(0)
+
+static inline int sign(int v)
+{
+	return (v > 0) - (v < 0);
+}
+
+static uint64_t eval_atom(const struct batch_insn* insn, const struct world_block* b)
+{
+	uint8_t r[BATCH_LANES];
+	const uint8_t* x0 = b->x[insn->slot[0]];
+	const uint8_t* x1 = b->x[insn->slot[1]];
+	const uint8_t* y0 = b->y[insn->slot[0]];
+	const uint8_t* y1 = b->y[insn->slot[1]];
+	const uint8_t* shape0 = b->shape[insn->slot[0]];
+	const uint8_t* shape1 = b->shape[insn->slot[1]];
+	const uint8_t* size0 = b->size_rank[insn->slot[0]];
+	const uint8_t* size1 = b->size_rank[insn->slot[1]];
+
+	switch(insn->pred)
+	{
+		case PRED_TET:       LANES(shape0[i] == 2);
+		case PRED_CUBE:      LANES(shape0[i] == 1);
+		case PRED_DODEC:     LANES(shape0[i] == 0);
+		case PRED_SMALL:     LANES(size0[i] == 0);
+		case PRED_MEDIUM:    LANES(size0[i] == 1);
+		case PRED_LARGE:     LANES(size0[i] == 2);
+		case PRED_LEFTOF:    LANES(x0[i] < x1[i]);
+		case PRED_RIGHTOF:   LANES(x0[i] > x1[i]);
+		case PRED_FRONTOF:   LANES(y0[i] > y1[i]);
+		case PRED_BACKOF:    LANES(y0[i] < y1[i]);
+		case PRED_SAMEROW:   LANES(y0[i] == y1[i]);
+		case PRED_SAMECOL:   LANES(x0[i] == x1[i]);
+		case PRED_SAMESHAPE: LANES(shape0[i] == shape1[i]);
+		case PRED_SAMESIZE:  LANES(size0[i] == size1[i]);
+		case PRED_ADJOINS:   LANES((x0[i] == x1[i] && (uint8_t)(y0[i] - y1[i] + 1) <= 2 && y0[i] != y1[i])
+		                           || (y0[i] == y1[i] && (uint8_t)(x0[i] - x1[i] + 1) <= 2 && x0[i] != x1[i]));
+		case PRED_LARGER:    LANES(size0[i] > size1[i]);
+		case PRED_SMALLER:   LANES(size0[i] < size1[i]);
+		case PRED_EQUAL:
+		{
+			const uint8_t* id0 = b->id[insn->slot[0]];
+			const uint8_t* id1 = b->id[insn->slot[1]];
+			LANES(id0[i] == id1[i]);
+		}
+		case PRED_BETWEEN:
+		{
+			// Same test as atom_holds, lane by lane
+			const uint8_t* x2 = b->x[insn->slot[2]];
+			const uint8_t* y2 = b->y[insn->slot[2]];
+			for(int i = 0; i < BATCH_LANES; i++)
+			{
+				int dx1 = x0[i] - x1[i], dy1 = y0[i] - y1[i];
+				int dx2 = x2[i] - x0[i], dy2 = y2[i] - y0[i];
+				bool line1 = (dx1 == 0 || dy1 == 0 || abs(dx1) == abs(dy1)) && (dx1 | dy1);
+				bool line2 = (dx2 == 0 || dy2 == 0 || abs(dx2) == abs(dy2)) && (dx2 | dy2);
+				r[i] = line1 && line2 && sign(dx1) == sign(dx2) && sign(dy1) == sign(dy2) ? 0xFF : 0;
+			}
+			return lane_mask(r);
+		}
+	}
+	return 0;
+}
+
+// Returns: lanes where some (exists) or every (forall) object satisfies the body
+static uint64_t eval_cells(const struct batch_insn* insn, const struct world_block* b)
+{
+	uint64_t invert = insn->b ? UINT64_MAX : 0;
+	uint64_t m = 0;
+
+	for(int i = 0; i < b->num_worlds; i++)
+	{
+		// Masked so a missing name's stale column cannot index past the tables
+		int c0 = ((b->x[insn->slot[0]][i] << 3) | b->y[insn->slot[0]][i]) & 63;
+		int c1 = ((b->x[insn->slot[1]][i] << 3) | b->y[insn->slot[1]][i]) & 63;
+		uint64_t cells = spatial_cells(insn->pred, insn->a, c0, c1) ^ invert;
+		bool v = insn->op == BATCH_EXISTS_CELLS ? (b->occupied[i] & cells) != 0 : !(b->occupied[i] & ~cells);
+		m |= (uint64_t)v << i;
+	}
+	return m;
+}
+
+void batch_eval(struct batch_program* p, const struct world_block* b, uint64_t* truth, uint64_t* undefined)
+{
+	uint64_t lanes = b->num_worlds == BATCH_LANES ? UINT64_MAX : (1ULL << b->num_worlds) - 1;
+	uint64_t defined = 0;
+	uint64_t* regs = p->regs;
+
+	for(int i = 0; i < b->num_worlds; i++)
+		if(!(p->names & ~b->names[i]))
+			defined |= 1ULL << i;
+
+	for(int n = 0; n < p->num_insns; n++)
+	{
+		const struct batch_insn* insn = &p->insns[n];
+		switch(insn->op)
+		{
+			case BATCH_ATOM:    regs[n] = eval_atom(insn, b); break;
+			case BATCH_CONST:   regs[n] = insn->a ? UINT64_MAX : 0; break;
+			case BATCH_NOT:     regs[n] = ~regs[insn->a]; break;
+			case BATCH_AND:     regs[n] = regs[insn->a] & regs[insn->b]; break;
+			case BATCH_OR:      regs[n] = regs[insn->a] | regs[insn->b]; break;
+			case BATCH_IMPLIES: regs[n] = ~regs[insn->a] | regs[insn->b]; break;
+			case BATCH_IFF:     regs[n] = ~(regs[insn->a] ^ regs[insn->b]); break;
+			case BATCH_EXISTS_CELLS:
+			case BATCH_FORALL_CELLS: regs[n] = eval_cells(insn, b); break;
+		}
+	}
+
+	*truth = p->num_insns ? regs[p->num_insns - 1] & lanes & defined : 0;
+	*undefined = lanes & ~defined;
+}
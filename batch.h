@@ -0,0 +1,92 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tarski.h"
+#include "sentence.h"
+
+// Batch evaluation of one sentence over blocks of 64 worlds with the same k.
+//
+// A block stores its worlds as columns: x, y, shape, size rank and object index
+// for every slot, one byte per world (lane). Slots 0..k-1 are the objects of
+// each world; slots BATCH_NAME_SLOT + n hold a copy of the object carrying name n.
+//
+// batch_compile() unrolls the quantifiers of a sentence for a fixed k into a
+// straight-line program: every instruction produces a 64-bit mask with bit i set
+// if it holds in world i of the block. Atoms compare two columns over all lanes,
+// connectives are single bitwise operations on the masks, and the result
+// instruction's mask is the block's truth bitmap. A quantifier nest of depth d
+// costs about k^d atoms, so compilation fails for programs over BATCH_MAX_INSNS.
+// A quantifier whose body is a single spatial atom is not unrolled; it becomes
+// one instruction testing each world's occupancy bitboard (see spatial.h).
+
+#define BATCH_LANES 64
+#define BATCH_NAME_SLOT MAX_OBJECTS_IN_WORLD
+#define BATCH_SLOTS (MAX_OBJECTS_IN_WORLD + 6)
+#define BATCH_MAX_INSNS 65536
+#define BATCH_NO_OBJECT 0xFF
+
+struct world_block
+{
+	int objects_in_world;
+	int num_worlds;
+	uint8_t x[BATCH_SLOTS][BATCH_LANES];
+	uint8_t y[BATCH_SLOTS][BATCH_LANES];
+	uint8_t shape[BATCH_SLOTS][BATCH_LANES];     // shape index, see count.h
+	uint8_t size_rank[BATCH_SLOTS][BATCH_LANES]; // 0 small, 1 medium, 2 large
+	uint8_t id[BATCH_SLOTS][BATCH_LANES];        // object index, BATCH_NO_OBJECT for a missing name
+	uint8_t names[BATCH_LANES];                  // names carried in each world
+	uint64_t occupied[BATCH_LANES];              // occupied cells of each world
+	uint32_t worlds[BATCH_LANES][MAX_OBJECTS_IN_WORLD];
+};
+
+enum batch_op
+{
+	BATCH_ATOM,
+	BATCH_CONST,
+	BATCH_NOT,
+	BATCH_AND,
+	BATCH_OR,
+	BATCH_IMPLIES,
+	BATCH_IFF,
+	BATCH_EXISTS_CELLS,  // exists x R(..x..), a = position of x, b = negated
+	BATCH_FORALL_CELLS   // forall x R(..x..), slot[] holds the other arguments
+};
+
+struct batch_insn
+{
+	uint8_t op;       // enum batch_op
+	uint8_t pred;     // enum sentence_pred, atoms and *_CELLS
+	uint8_t slot[3];  // atom arguments, or the non-variable arguments of *_CELLS
+	int32_t a, b;     // operand instructions; a is the value of BATCH_CONST
+};
+
+// A program keeps its own registers, so each thread compiles its own
+struct batch_program
+{
+	int objects_in_world;
+	uint8_t names;    // names the sentence mentions
+	int num_insns;
+	struct batch_insn* insns;
+	uint64_t* regs;
+};
+
+// Effects: Compiles s for worlds of objects_in_world objects. Returns false if the
+//   program would exceed BATCH_MAX_INSNS or on allocation failure.
+bool batch_compile(const struct sentence* s, int objects_in_world, struct batch_program* p);
+void batch_program_free(struct batch_program* p);
+
+// Effects: Empties b for worlds of objects_in_world objects
+void world_block_reset(struct world_block* b, int objects_in_world);
+
+// Requires: b is not full, w holds b->objects_in_world objects
+// Effects: Appends w as the next lane. Returns true if b is now full.
+bool world_block_add(struct world_block* b, const uint32_t w[]);
+
+// Requires: p was compiled for b->objects_in_world
+// Effects: *truth = lanes where the sentence is true, *undefined = lanes where a
+//   name it mentions is missing (neither bit is set for lanes past num_worlds)
+void batch_eval(struct batch_program* p, const struct world_block* b, uint64_t* truth, uint64_t* undefined);
+
+#endif /* #ifndef __BATCH_H__ */
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "tarski.h"
+#include "count.h"
+#include "sample.h"
+#include "rng.h"
+#include "canon.h"
+
+// Returns: cell (x, y) under board symmetry t: bit 2 swaps x and y, then bit 0
+//   mirrors x and bit 1 mirrors y
+static inline uint32_t transform_cell(uint32_t cell, int t)
+{
+	uint32_t x = cell >> 3, y = cell & 7;
+	if(t & 4)
+	{
+		uint32_t s = x;
+		x = y;
+		y = s;
+	}
+	if(t & 1)
+		x = 7 - x;
+	if(t & 2)
+		y = 7 - y;
+	return x * 8 + y;
+}
+
+// Effects: Writes the canonical form of w under one board symmetry to out
+static void canon_image(const uint32_t w[], int k, unsigned symmetry, int t, uint32_t out[])
+{
+	uint32_t keys[MAX_OBJECTS_IN_WORLD];
+
+	// Without labels the key is the body; the number of names rides in the low
+	// bits so objects that only differ in it still sort the same way every time
+	for(int i = 0; i < k; i++)
+	{
+		uint32_t o = (w[i] & ~(63u << 6)) | (transform_cell(OBJECT_CELL(w[i]), t) << 6);
+		keys[i] = symmetry & CANON_LABELS ? (o & ~ALL_LABELS) | __builtin_popcount(OBJECT_LABELS(o)) : o;
+	}
+	for(int i = 1; i < k; i++)
+	{
+		uint32_t v = keys[i];
+		int j = i - 1;
+		while(j >= 0 && keys[j] > v)
+		{
+			keys[j + 1] = keys[j];
+			j--;
+		}
+		keys[j + 1] = v;
+	}
+
+	int next = 0;
+	for(int i = 0; i < k; i++)
+	{
+		if(!(symmetry & CANON_LABELS))
+		{
+			out[i] = keys[i];
+			continue;
+		}
+		int names = keys[i] & 7;
+		out[i] = (keys[i] & ~ALL_LABELS) | (((1u << names) - 1) << next);
+		next += names;
+	}
+}
+
+void canon_world(const uint32_t w[], int sizeof_w, unsigned symmetry, uint32_t out[])
+{
+	uint32_t best[MAX_OBJECTS_IN_WORLD], image[MAX_OBJECTS_IN_WORLD];
+
+	canon_image(w, sizeof_w, symmetry, 0, best);
+	for(int t = 1; t < (symmetry & CANON_D4 ? 8 : 1); t++)
+	{
+		canon_image(w, sizeof_w, symmetry, t, image);
+		int i = 0;
+		while(i < sizeof_w && image[i] == best[i])
+			i++;
+		if(i < sizeof_w && image[i] < best[i])
+			memcpy(best, image, sizeof_w * sizeof(*image));
+	}
+	memcpy(out, best, sizeof_w * sizeof(*best));
+}
+
+// Returns: the splitmix64 finalizer of x
+static inline uint64_t mix64(uint64_t x)
+{
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+struct canon_fp canon_fingerprint(const uint32_t c[], int sizeof_w)
+{
+	struct canon_fp fp;
+	uint64_t lo = 0x9e3779b97f4a7c15ULL + sizeof_w;
+	uint64_t hi = 0xd1342543de82ef95ULL ^ sizeof_w;
+
+	// Three 18-bit objects per word
+	for(int i = 0; i < sizeof_w; i += 3)
+	{
+		uint64_t word = c[i];
+		if(i + 1 < sizeof_w) word |= (uint64_t)c[i + 1] << 18;
+		if(i + 2 < sizeof_w) word |= (uint64_t)c[i + 2] << 36;
+		lo = mix64(lo ^ word) + 0x9e3779b97f4a7c15ULL;
+		hi = mix64((hi + word) * 0xff51afd7ed558ccdULL);
+	}
+	fp.lo = mix64(lo);
+	fp.hi = mix64(hi ^ (hi >> 29));
+	if(!fp.lo) fp.lo = 1;
+	if(!fp.hi) fp.hi = 1;
+	return fp;
+}
+
+uint64_t canon_set_capacity(uint64_t max_entries)
+{
+	uint64_t n = 16;
+	while(n < max_entries + max_entries / 3 + 1)
+		n *= 2;
+	return n;
+}
+
+bool canon_set_init(struct canon_set* s, uint64_t max_entries)
+{
+	uint64_t n = canon_set_capacity(max_entries);
+
+	s->slots = calloc(n, sizeof(*s->slots));
+	if(!s->slots)
+		return false;
+	s->mask = n - 1;
+	s->max_entries = max_entries;
+	s->entries = 0;
+	return true;
+}
+
+void canon_set_free(struct canon_set* s)
+{
+	free(s->slots);
+	s->slots = NULL;
+}
+
+// Returns: the low word of a claimed slot once its owner has published it
+static inline uint64_t slot_lo(const struct canon_slot* slot)
+{
+	uint64_t lo;
+	while(!(lo = __atomic_load_n(&slot->lo, __ATOMIC_ACQUIRE)))
+		;
+	return lo;
+}
+
+enum canon_insert canon_set_insert(struct canon_set* s, struct canon_fp fp)
+{
+	for(uint64_t i = fp.lo & s->mask;; i = (i + 1) & s->mask)
+	{
+		struct canon_slot* slot = &s->slots[i];
+		uint64_t hi = __atomic_load_n(&slot->hi, __ATOMIC_ACQUIRE);
+
+		if(!hi)
+		{
+			// The end of the probe: fp is new. Reserve an entry before claiming the
+			// slot, so at most max_entries slots are ever taken and an empty one
+			// always ends every probe.
+			if(__atomic_fetch_add(&s->entries, 1, __ATOMIC_RELAXED) >= s->max_entries)
+			{
+				__atomic_fetch_sub(&s->entries, 1, __ATOMIC_RELAXED);
+				return CANON_FULL;
+			}
+			if(__atomic_compare_exchange_n(&slot->hi, &hi, fp.hi, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			{
+				__atomic_store_n(&slot->lo, fp.lo, __ATOMIC_RELEASE);
+				return CANON_INSERTED;
+			}
+			// Another thread took the slot; hi is now its key
+			__atomic_fetch_sub(&s->entries, 1, __ATOMIC_RELAXED);
+		}
+		if(hi == fp.hi && slot_lo(slot) == fp.lo)
+			return CANON_PRESENT;
+	}
+}
+
+bool canon_set_contains(const struct canon_set* s, struct canon_fp fp)
+{
+	for(uint64_t i = fp.lo & s->mask;; i = (i + 1) & s->mask)
+	{
+		const struct canon_slot* slot = &s->slots[i];
+		uint64_t hi = __atomic_load_n(&slot->hi, __ATOMIC_ACQUIRE);
+
+		if(!hi)
+			return false;
+		if(hi == fp.hi && slot_lo(slot) == fp.lo)
+			return true;
+	}
+}
+
+enum canon_insert canon_set_add_world(struct canon_set* s, const uint32_t w[], int sizeof_w, unsigned symmetry)
+{
+	uint32_t c[MAX_OBJECTS_IN_WORLD];
+
+	canon_world(w, sizeof_w, symmetry, c);
+	return canon_set_insert(s, canon_fingerprint(c, sizeof_w));
+}
+
+struct dedup_worker
+{
+	const struct world_sampler* sampler;
+	int k;
+	uint64_t n;
+	uint64_t seed;
+	int stream;
+	unsigned symmetry;
+	struct canon_set* set;
+	uint64_t counts[3];     // by enum canon_insert
+	pthread_t tid;
+};
+
+static void* dedup_thread(void* arg)
+{
+	struct dedup_worker* d = arg;
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+	struct rng r;
+
+	rng_seed(&r, d->seed, d->stream);
+	for(uint64_t i = 0; i < d->n; i++)
+	{
+		sampler_draw(d->sampler, &r, d->k, w);
+		d->counts[canon_set_add_world(d->set, w, d->k, d->symmetry)]++;
+	}
+	return NULL;
+}
+
+bool canon_dedup_sampled(const struct world_sampler* sampler, int objects_in_world, uint64_t n, int threads,
+	uint64_t seed, unsigned symmetry, struct canon_set* set, struct dedup_stats* stats)
+{
+	struct timespec start, end;
+
+	if(threads <= 0)
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(threads <= 0)
+		threads = 1;
+	struct dedup_worker* workers = calloc(threads, sizeof(*workers));
+	if(!workers)
+	{
+		perror("calloc");
+		return false;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int started = 0;
+	for(int t = 0; t < threads; t++)
+	{
+		struct dedup_worker* d = &workers[t];
+		d->sampler = sampler;
+		d->k = objects_in_world;
+		d->n = n / threads + ((uint64_t)t < n % threads);
+		d->seed = seed;
+		d->stream = t;
+		d->symmetry = symmetry;
+		d->set = set;
+		if(pthread_create(&d->tid, NULL, dedup_thread, d) != 0)
+		{
+			fprintf(stderr, "pthread_create failed\n");
+			break;
+		}
+		started++;
+	}
+	for(int t = 0; t < started; t++)
+		pthread_join(workers[t].tid, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	memset(stats, 0, sizeof(*stats));
+	for(int t = 0; t < started; t++)
+	{
+		stats->drawn += workers[t].n;
+		stats->distinct += workers[t].counts[CANON_INSERTED];
+		stats->duplicates += workers[t].counts[CANON_PRESENT];
+		stats->refused += workers[t].counts[CANON_FULL];
+	}
+	stats->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+	free(workers);
+	return started > 0;
+}
@@ -0,0 +1,109 @@
+#ifndef __CANON_H__
+#define __CANON_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tarski.h"
+#include "sample.h"
+
+// Canonical worlds and a concurrent set of their fingerprints, for dropping
+// generated worlds that only differ in object order, names or board symmetry.
+//
+// canon_world maps every world of an equivalence class to the same packed world:
+//   order   objects sorted by their encoding
+//   labels  names renamed by first use: in (size, shape, cell) order each object
+//           takes the next unused names, as many as it had. Names are never
+//           shared, so this is the smallest relabelling of the world.
+//   d4      the smallest, by the two rules above, of the 8 images of the world
+//           under the rotations and reflections of the board
+// Validity does not change under any of these. Sentences with LeftOf, BackOf and
+// the like are not invariant under the board symmetries, so callers pick the
+// symmetries they can afford to forget.
+//
+// A fingerprint is two independent 64-bit hashes of the canonical world, neither
+// of them 0. The set is an open-addressing table of fingerprints with linear
+// probing and a capacity fixed at init: a thread claims an empty slot with a
+// compare-and-swap on its high word, then publishes the low word. A probe that
+// meets its own high word waits for the low word of that slot, the only window
+// in which a thread depends on another. An insert reserves its entry with an
+// atomic add on the count before it claims a slot and gives it back if it loses
+// the slot, so no more than max_entries slots are ever taken, whatever the number
+// of threads, and every probe ends at an empty slot. Once max_entries
+// fingerprints are in (or reserved), new ones are refused rather than the table
+// growing.
+
+#define CANON_ORDER  0
+#define CANON_LABELS 1
+#define CANON_D4     2
+#define CANON_ALL    (CANON_LABELS | CANON_D4)
+
+struct canon_fp
+{
+	uint64_t lo;
+	uint64_t hi;
+};
+
+struct canon_slot
+{
+	uint64_t hi;            // 0 = empty, claimed first
+	uint64_t lo;            // 0 until published
+};
+
+struct canon_set
+{
+	struct canon_slot* slots;
+	uint64_t mask;          // capacity - 1
+	uint64_t max_entries;
+	uint64_t entries;
+};
+
+enum canon_insert
+{
+	CANON_INSERTED,
+	CANON_PRESENT,
+	CANON_FULL
+};
+
+// Requires: 0 <= sizeof_w <= MAX_OBJECTS_IN_WORLD, objects on distinct cells
+// Modifies: out
+// Effects: Writes the canonical form of w under symmetry (CANON_* bits) to out,
+//   which may alias w
+void canon_world(const uint32_t w[], int sizeof_w, unsigned symmetry, uint32_t out[]);
+
+// Returns: the fingerprint of canonical world c
+struct canon_fp canon_fingerprint(const uint32_t c[], int sizeof_w);
+
+// Effects: Prepares an empty set for up to max_entries fingerprints in a table of
+//   at least 4/3 that many slots. Returns false on allocation failure.
+bool canon_set_init(struct canon_set* s, uint64_t max_entries);
+void canon_set_free(struct canon_set* s);
+
+// Returns: the slots canon_set_init allocates for max_entries
+uint64_t canon_set_capacity(uint64_t max_entries);
+
+// Effects: Adds fp to s unless it is already there or s is full. Safe to call
+//   from any number of threads at once.
+enum canon_insert canon_set_insert(struct canon_set* s, struct canon_fp fp);
+bool canon_set_contains(const struct canon_set* s, struct canon_fp fp);
+
+// Effects: canon_set_insert of the fingerprint of w's canonical form
+enum canon_insert canon_set_add_world(struct canon_set* s, const uint32_t w[], int sizeof_w, unsigned symmetry);
+
+struct dedup_stats
+{
+	uint64_t drawn;
+	uint64_t distinct;
+	uint64_t duplicates;
+	uint64_t refused;       // set full
+	double seconds;
+};
+
+// Requires: sampler_can_draw(sampler, objects_in_world)
+// Modifies: *set, *stats
+// Effects: Has threads (0 = online CPUs) draw n uniform worlds between them,
+//   worker i from (seed, stream i), and add them to set. Returns false if no
+//   thread could be started.
+bool canon_dedup_sampled(const struct world_sampler* sampler, int objects_in_world, uint64_t n, int threads,
+	uint64_t seed, unsigned symmetry, struct canon_set* set, struct dedup_stats* stats);
+
+#endif /* #ifndef __CANON_H__ */
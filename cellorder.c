@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+#include "kernels.h"
+#include "cellorder.h"
+
+#define KERNEL static inline __attribute__((always_inline))
+
+static int compare_cell_order(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	if(OBJECT_CELL(x) != OBJECT_CELL(y))
+		return OBJECT_CELL(x) < OBJECT_CELL(y) ? -1 : 1;
+	if(OBJECT_SIZE(x) != OBJECT_SIZE(y))
+		return __builtin_ctz(OBJECT_SIZE(x)) < __builtin_ctz(OBJECT_SIZE(y)) ? -1 : 1;
+	if(OBJECT_SHAPE(x) != OBJECT_SHAPE(y))
+		return __builtin_ctz(OBJECT_SHAPE(x)) < __builtin_ctz(OBJECT_SHAPE(y)) ? -1 : 1;
+	return OBJECT_LABELS(x) < OBJECT_LABELS(y) ? -1 : OBJECT_LABELS(x) > OBJECT_LABELS(y);
+}
+
+bool cell_order_build(struct cell_order* co, const uint32_t objects[], int num_objects)
+{
+	memset(co, 0, sizeof(*co));
+	co->objects = malloc(num_objects * sizeof(*co->objects) + 1);
+	co->group_of = malloc(num_objects * sizeof(*co->group_of) + 1);
+	co->groups = malloc(num_objects * sizeof(*co->groups) + 1);
+	if(!co->objects || !co->group_of || !co->groups)
+	{
+		cell_order_free(co);
+		return false;
+	}
+	memcpy(co->objects, objects, num_objects * sizeof(*objects));
+	qsort(co->objects, num_objects, sizeof(*co->objects), compare_cell_order);
+	co->num_objects = num_objects;
+
+	for(int free = 0; free < 64; free++)
+		for(int l = 0; l < 64; l++)
+			if(!(l & ~free))
+				co->subsets[free] |= 1ULL << l;
+
+	// Cell ranges and (size, shape) groups
+	int i = 0;
+	for(int c = 0; c < NUM_CELLS; c++)
+	{
+		co->cell_start[c] = i;
+		co->large_end[c] = i;
+		while(i < num_objects && OBJECT_CELL(co->objects[i]) == c)
+		{
+			uint32_t first = co->objects[i];
+			struct object_group* g = &co->groups[co->num_groups];
+			g->start = i;
+			g->labels = 0;
+			while(i < num_objects && OBJECT_CELL(co->objects[i]) == c
+				&& (co->objects[i] >> 12) == (first >> 12))
+			{
+				g->labels |= 1ULL << OBJECT_LABELS(co->objects[i]);
+				co->group_of[i++] = co->num_groups;
+			}
+			g->end = i;
+			if(OBJECT_SIZE(first) & 1)
+				co->large_end[c] = i;
+
+			for(int free = 0; free < 64; free++)
+			{
+				int n = __builtin_popcountll(g->labels & co->subsets[free]);
+				co->cell_count[c][free] += n;
+				if(OBJECT_SIZE(first) & 1)
+					co->large_count[c][free] += n;
+			}
+			co->num_groups++;
+		}
+	}
+	co->cell_start[NUM_CELLS] = i;
+
+	for(int free = 0; free < 64; free++)
+	{
+		co->suffix_count[NUM_CELLS][free] = 0;
+		for(int c = NUM_CELLS - 1; c >= 0; c--)
+			co->suffix_count[c][free] = co->suffix_count[c + 1][free] + co->cell_count[c][free];
+	}
+	return true;
+}
+
+void cell_order_free(struct cell_order* co)
+{
+	free(co->objects);
+	free(co->group_of);
+	free(co->groups);
+	co->objects = NULL;
+	co->group_of = NULL;
+	co->groups = NULL;
+}
+
+// Returns: the first object after i in its group whose labels avoid the names in
+//   used, or the end of the group
+KERNEL int next_label(const struct cell_order* co, int i, uint32_t used)
+{
+	const struct object_group* g = &co->groups[co->group_of[i]];
+	int l = OBJECT_LABELS(co->objects[i]);
+	uint64_t later = l == 63 ? 0 : ~0ULL << (l + 1);
+	uint64_t m = g->labels & co->subsets[ALL_LABELS & ~used] & later;
+	if(!m)
+		return g->end;
+	return g->start + __builtin_popcountll(g->labels & ((1ULL << __builtin_ctzll(m)) - 1));
+}
+
+// Returns: the number of objects on cells >= first_cell that can join a world with
+//   the given centers, edges and names
+KERNEL uint64_t count_last(const struct cell_order* co, int first_cell, uint64_t centers, uint64_t edges, uint32_t used)
+{
+	int free = ALL_LABELS & ~used;
+	uint64_t later = first_cell >= NUM_CELLS ? 0 : ~0ULL << first_cell;
+	uint64_t n = co->suffix_count[first_cell][free];
+
+	// Cells under an edge take no center at all
+	for(uint64_t e = edges & later; e; e &= e - 1)
+		n -= co->cell_count[__builtin_ctzll(e)][free];
+	// Large objects next to a center would cover it
+	for(uint64_t a = board_neighbours(centers) & later & ~edges; a; a &= a - 1)
+		n -= co->large_count[__builtin_ctzll(a)][free];
+	return n;
+}
+
+KERNEL uint64_t count_fixed(const struct cell_order* co, int first_lead, int last_lead, const int k)
+{
+	uint64_t centers[MAX_OBJECTS_IN_WORLD], edges[MAX_OBJECTS_IN_WORLD];
+	uint32_t used[MAX_OBJECTS_IN_WORLD];
+	int pos[MAX_OBJECTS_IN_WORLD], next_cell[MAX_OBJECTS_IN_WORLD];
+	uint64_t accepted = 0;
+	int d = 0, i = first_lead;
+
+	centers[0] = edges[0] = 0;
+	used[0] = 0;
+	while(true)
+	{
+		if(d == k - 1)
+			accepted += count_last(co, next_cell[d], centers[d], edges[d], used[d]);
+		else if(i < (d == 0 ? last_lead : co->num_objects))
+		{
+			uint32_t o = co->objects[i];
+			int c = OBJECT_CELL(o);
+			uint64_t b = 1ULL << c;
+			bool large = o & (1 << 15);
+
+			// Rejections skip every object they apply to
+			if(edges[d] & b)
+				i = co->cell_start[c + 1];
+			else if(large && (board_neighbours(b) & centers[d]))
+				i = co->large_end[c];
+			else if(used[d] & OBJECT_LABELS(o))
+				i = next_label(co, i, used[d]);
+			else
+			{
+				centers[d + 1] = centers[d] | b;
+				edges[d + 1] = edges[d] | (large ? board_neighbours(b) : 0);
+				used[d + 1] = used[d] | OBJECT_LABELS(o);
+				next_cell[d + 1] = c + 1;
+				pos[d] = i;
+				// One object per cell: the next one starts on the next cell
+				i = co->cell_start[c + 1];
+				d++;
+			}
+			continue;
+		}
+
+		// Back to the previous object and its next candidate
+		if(--d < 0)
+			break;
+		i = pos[d] + 1;
+	}
+	return accepted;
+}
+
+typedef uint64_t (*count_kernel)(const struct cell_order* co, int first_lead, int last_lead);
+
+#define DEFINE_COUNT_KERNEL(K)                                                         \
+	static uint64_t count_##K(const struct cell_order* co, int first_lead, int last_lead) \
+	{                                                                                  \
+		return count_fixed(co, first_lead, last_lead, K);                              \
+	}
+
+DEFINE_COUNT_KERNEL(2)
+DEFINE_COUNT_KERNEL(3)
+DEFINE_COUNT_KERNEL(4)
+DEFINE_COUNT_KERNEL(5)
+DEFINE_COUNT_KERNEL(6)
+DEFINE_COUNT_KERNEL(7)
+DEFINE_COUNT_KERNEL(8)
+DEFINE_COUNT_KERNEL(9)
+DEFINE_COUNT_KERNEL(10)
+DEFINE_COUNT_KERNEL(11)
+DEFINE_COUNT_KERNEL(12)
+
+#if MAX_OBJECTS_IN_WORLD != 12
+#error "cellorder.c instantiates k = 2..12; update the kernel list for MAX_OBJECTS_IN_WORLD"
+#endif
+
+static const count_kernel count_kernels[MAX_OBJECTS_IN_WORLD + 1] =
+{
+	NULL, NULL, count_2, count_3, count_4, count_5, count_6,
+	count_7, count_8, count_9, count_10, count_11, count_12
+};
+
+void cell_order_count(const struct cell_order* co, int objects_in_world, int first_lead, int last_lead, struct bn* count)
+{
+	struct bn n;
+
+	if(last_lead > co->num_objects)
+		last_lead = co->num_objects;
+	if(objects_in_world == 0)
+	{
+		if(first_lead <= 0 && last_lead > 0)
+			bignum_inc(count);
+		return;
+	}
+	if(first_lead < 0)
+		first_lead = 0;
+	if(first_lead >= last_lead)
+		return;
+
+	// A single object is always a valid world
+	if(objects_in_world == 1)
+		bignum_from_int(&n, last_lead - first_lead);
+	else
+		bignum_from_int(&n, count_kernels[objects_in_world](co, first_lead, last_lead));
+	bignum_add(count, &n, count);
+}
@@ -0,0 +1,63 @@
+#ifndef __CELLORDER_H__
+#define __CELLORDER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+
+// Objects grouped by cell for counting.
+//
+// The objects are reordered by (cell, size index, shape index, labels), so the
+// objects of one cell form one range and, inside it, each (size, shape) pair
+// forms a group of increasing label masks; large objects (size index 0) come
+// first in their cell. Offset tables give the range of each cell, the end of its
+// large objects and the group of every object.
+//
+// The counter picks the objects of a world in increasing cell order, so after
+// an object it continues at the next cell, never trying another object on the
+// same one. A candidate whose cell lies under a large object's edge skips the
+// rest of its cell, a large candidate whose edges would cover a center skips the
+// rest of the cell's large objects, and a name clash jumps to the next label mask
+// of the group that is disjoint from the names in use. The last object of a world
+// is not chosen at all: the number of compatible objects on the remaining cells
+// is a suffix sum over cells for the free names, minus the cells under edges and
+// the large objects next to a center.
+
+struct object_group
+{
+	int start;              // objects [start, end) in cell order
+	int end;
+	uint64_t labels;        // label masks present, bit l = mask l
+};
+
+struct cell_order
+{
+	uint32_t* objects;      // cell order
+	int num_objects;
+	int32_t* group_of;      // group of each object
+	struct object_group* groups;
+	int num_groups;
+	int cell_start[NUM_CELLS + 1];
+	int large_end[NUM_CELLS];               // large objects of cell c end here
+	uint64_t subsets[64];                   // label masks that use only the names in each set
+	// Objects whose labels use only free names: [cell][free names]
+	uint32_t cell_count[NUM_CELLS][64];
+	uint32_t large_count[NUM_CELLS][64];
+	uint64_t suffix_count[NUM_CELLS + 1][64];  // cells >= c
+};
+
+// Requires: objects has no duplicates
+// Effects: Builds the cell order of objects. Returns false on allocation failure.
+bool cell_order_build(struct cell_order* co, const uint32_t objects[], int num_objects);
+void cell_order_free(struct cell_order* co);
+
+// Requires: 0 <= objects_in_world <= MAX_OBJECTS_IN_WORLD
+// Modifies: *count
+// Effects: Adds to *count the number of valid worlds of objects_in_world objects
+//   whose first object in cell order has its index in [first_lead, last_lead). The
+//   empty world is counted by the lead range containing 0.
+void cell_order_count(const struct cell_order* co, int objects_in_world, int first_lead, int last_lead, struct bn* count);
+
+#endif /* #ifndef __CELLORDER_H__ */
@@ -0,0 +1,266 @@
+#!/bin/sh
+# Cross-checks the counting engines of tarski against the closed form for small
+# worlds: there are
+#   count(k) = C(64, k) * 6^k * (k + 1)^6
+# valid worlds of k objects (k of the 64 cells, one of 6 shape and size pairs per
+# object, and each of the 6 names on one of the k objects or on none). The other
+# modes are then checked against answers known for small worlds and against each
+# other.
+# Usage: sh check.sh [tarski binary] [checklib binary]
+
+tarski=${1:-./tarski}
+checklib=${2:-}
+failures=0
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+# count(k) and the totals through k, for k = 0..3
+level_hex="1 6000 3274f80 895200000"
+level_dec="1 24576 52907904 36861640704"
+total_hex="1 6001 327af81 89847af81"
+# Total through k = MAX_OBJECTS_IN_WORLD = 12
+all_hex=7227780240417b0ab703d681
+all_dec=35329005952099858055147280001
+
+# Returns: entry k (from 0) of list
+nth()
+{
+	echo "$2" | cut -d' ' -f$(($1 + 1))
+}
+
+# Returns: the running total printed after "Objects in world: k" on stdin
+objects_in_world()
+{
+	awk -v k="$1" '$1 == "Objects" && $4 == k { getline; print $NF }'
+}
+
+# Returns: the level count printed after "Worlds of k objects:" on stdin
+worlds_of()
+{
+	awk -v k="$1" '$1 == "Worlds" && $3 == k { getline; print $NF }'
+}
+
+expect()
+{
+	if [ "$2" = "$3" ]; then
+		echo "ok    $1"
+	else
+		echo "FAIL  $1: got '$2', expected '$3'"
+		failures=$((failures + 1))
+	fi
+}
+
+out=$("$tarski" --frontier 3 2>/dev/null)
+for k in 0 1 2 3; do
+	expect "frontier k=$k" "$(echo "$out" | objects_in_world $k)" "$(nth $k "$total_hex")"
+done
+
+out=$("$tarski" --zdd 2>/dev/null)
+for k in 0 1 2 3; do
+	expect "zdd k=$k" "$(echo "$out" | objects_in_world $k)" "$(nth $k "$total_hex")"
+done
+expect "zdd k=12" "$(echo "$out" | objects_in_world 12)" "$all_hex"
+
+for k in 0 1 2; do
+	expect "pipeline k=$k" "$("$tarski" --pipeline $k 2>/dev/null | worlds_of $k)" "$(nth $k "$level_hex")"
+done
+
+for k in 0 1 2 3; do
+	expect "orbits k=$k" "$("$tarski" --orbits $k 2>/dev/null | worlds_of $k)" "$(nth $k "$level_hex")"
+done
+
+out=$("$tarski" --perf 3 1 2>/dev/null)
+for k in 1 2 3; do
+	expect "count_level_by_cell k=$k" "$(echo "$out" | awk -v k=$k '$1 == "count_level_by_cell" && $2 == k { print $3 }')" \
+		"$(nth $k "$level_dec")"
+done
+
+for k in 0 1 2 3; do
+	expect "dist k=$k" "$("$tarski" --dist k=$k 2>/dev/null)" "$(nth $k "$level_dec")"
+done
+expect "dist total" "$("$tarski" --dist 2>/dev/null)" "$all_dec"
+
+# World files: level 1 reads back as the same 24576 distinct worlds in both
+# encodings, and a truncated file is refused
+"$tarski" --dump 1 "$tmp/packed.tw" >/dev/null 2>&1
+"$tarski" --dump 1 "$tmp/index.tw" index >/dev/null 2>&1
+"$tarski" --read "$tmp/packed.tw" 0 24576 >"$tmp/packed.txt" 2>/dev/null
+"$tarski" --read "$tmp/index.tw" 0 24576 >"$tmp/index.txt" 2>/dev/null
+expect "world file header" "$(head -n 1 "$tmp/packed.txt")" "Worlds: 24576, objects in world: 1"
+expect "world file worlds" "$(tail -n +2 "$tmp/packed.txt" | sort -u | wc -l | tr -d ' ')" 24576
+expect "world file encodings agree" "$(cmp -s "$tmp/packed.txt" "$tmp/index.txt"; echo $?)" 0
+head -c 1000 "$tmp/packed.tw" >"$tmp/truncated.tw"
+expect "truncated world file refused" "$("$tarski" --read "$tmp/truncated.tw" >/dev/null 2>&1; echo $?)" 1
+
+# Sentence evaluation on one world: a small cube a at (0, 0), a medium
+# tetrahedron b at (2, 0) and a medium dodecahedron c at (1, 0) between them
+world="139265 82946 70148"
+while IFS='	' read -r value sentence; do
+	expect "eval $sentence" "$("$tarski" --eval "$sentence" $world 2>/dev/null)" "$value"
+done <<'END'
+true	Cube(a)
+false	Tet(a)
+true	LeftOf(a, b)
+false	RightOf(a, b)
+false	FrontOf(a, b)
+true	SameRow(a, b)
+false	SameCol(a, b)
+true	Adjoins(a, c)
+false	Adjoins(a, b)
+true	Between(c, a, b)
+false	Between(a, b, c)
+true	Smaller(a, b)
+true	SameSize(b, c)
+false	Larger(a, c)
+true	~(a = b)
+true	forall x (Small(x) | Medium(x))
+true	exists x (Tet(x) & Larger(x, a))
+true	forall x forall y (SameShape(x, y) -> x = y)
+undefined	Cube(d)
+END
+expect "eval parse error" "$("$tarski" --eval 'Cube(' $world >/dev/null 2>&1; echo $?)" 1
+
+# Model counting: of the C(64, 2) * 36 * 3^6 worlds of 2 objects, Cube(a) holds in
+# C(64, 2) * 2 * 12 * 3^5 (a on either object, a cube of 2 sizes beside any of 6
+# bodies) and forall x Small(x) in C(64, 2) * 9 * 3^6. At k = 1 the counts after
+# constraint pushdown match an evaluation of every world of the level.
+expect "models Cube(a) k=2" "$("$tarski" --models 'Cube(a)' 2 2>/dev/null | objects_in_world 2)" b36700
+expect "models forall x Small(x) k=2" "$("$tarski" --models 'forall x Small(x)' 2 2>/dev/null | objects_in_world 2)" c9d3e0
+while read -r sentence; do
+	models=$("$tarski" --models "$sentence" 1 2>/dev/null | objects_in_world 1)
+	expect "models $sentence k=1" "true: $(printf '%d' "0x${models:-0}")" \
+		"$("$tarski" --eval "$sentence" "$tmp/packed.tw" 2>/dev/null | cut -d, -f1)"
+done <<'END'
+Cube(a)
+forall x (Cube(x) -> Medium(x))
+exists x (Dodec(x) & ~Large(x))
+a = b
+SameRow(a, b)
+Cube(a) | Tet(b)
+END
+
+# Batch evaluation agrees with evaluating the worlds one at a time, over 100
+# sampled worlds of 4 objects (a full block of 64 and a partial one)
+"$tarski" --sample 4 100 1 "$tmp/sampled.tw" >/dev/null 2>&1
+"$tarski" --read "$tmp/sampled.tw" 0 100 2>/dev/null | tail -n +2 >"$tmp/sampled.txt"
+
+# Returns: the --eval tally of sentence over the sampled worlds, one world at a time
+eval_each()
+{
+	while read -r w; do
+		"$tarski" --eval "$1" $w 2>/dev/null
+	done <"$tmp/sampled.txt" | awk '{ n[$1]++ }
+		END { printf "true: %d, false: %d, undefined: %d", n["true"], n["false"], n["undefined"] }'
+}
+
+while read -r sentence; do
+	expect "batch $sentence" "$("$tarski" --eval "$sentence" "$tmp/sampled.tw" 2>/dev/null)" "$(eval_each "$sentence")"
+done <<'END'
+Cube(a)
+forall x (Small(x) | Tet(x))
+exists x (Cube(x) & Larger(x, a))
+forall x exists y (SameShape(x, y) & ~(x = y))
+exists x exists y (x = a & y = b & SameSize(x, y))
+END
+
+# Quantifiers over a single spatial atom run on the occupancy bitboards, in batch
+# and one world at a time; the same sentence with a trivial conjunct (or
+# disjunct) added is unrolled instead, and all three must agree
+while IFS='	' read -r sentence unrolled; do
+	expected=$("$tarski" --eval "$unrolled" "$tmp/sampled.tw" 2>/dev/null)
+	expect "bitboard batch $sentence" "$("$tarski" --eval "$sentence" "$tmp/sampled.tw" 2>/dev/null)" "$expected"
+	expect "bitboard each $sentence" "$(eval_each "$sentence")" "$expected"
+done <<'END'
+exists x LeftOf(x, a)	exists x (LeftOf(x, a) & x = x)
+forall x ~Adjoins(x, a)	forall x (~Adjoins(x, a) | ~(x = x))
+exists x Between(a, x, b)	exists x (Between(a, x, b) & x = x)
+forall x (Cube(x) -> exists y FrontOf(y, x))	forall x (Cube(x) -> exists y (FrontOf(y, x) & y = y))
+forall x ~SameCol(x, b)	forall x (~SameCol(x, b) | ~(x = x))
+END
+
+# Incremental re-evaluation: after a run of edits to the world above, the values
+# the editor holds match a fresh evaluation of the world it shows
+cat >"$tmp/sentences.txt" <<'END'
+Cube(a)
+exists x (Tet(x) & LeftOf(x, a))
+forall x (Small(x) | Medium(x))
+Adjoins(a, c)
+Between(c, a, b)
+Cube(d)
+END
+printf 'move 0 4 4\nshape 1 cube\nnames 1 bd\nsize 2 small\nmove 2 5 4\nshow\n' \
+	| "$tarski" --edit "$tmp/sentences.txt" $world 2>/dev/null | tail -n 8 >"$tmp/edited.txt"
+edited=$(head -n 1 "$tmp/edited.txt")
+expect "edit world" "$(echo $edited)" "141569 74762 137988"
+i=0
+while read -r sentence; do
+	expect "edit $sentence" "$(grep "^$i: " "$tmp/edited.txt" | cut -d' ' -f2)" \
+		"$("$tarski" --eval "$sentence" $edited 2>/dev/null)"
+	i=$((i + 1))
+done <"$tmp/sentences.txt"
+
+# World search: every world found is valid (it has a rank) and makes the
+# sentences true, the one marked ! false; a contradiction has no worlds
+cat >"$tmp/solve.txt" <<'END'
+Cube(a)
+exists x (Tet(x) & LeftOf(x, a))
+!Small(a)
+forall x (Cube(x) -> ~SameRow(x, b))
+END
+"$tarski" --solve "$tmp/solve.txt" 5 3-4 2>/dev/null | grep -v '^Found' >"$tmp/solved.txt"
+expect "solve worlds found" "$(wc -l <"$tmp/solved.txt" | tr -d ' ')" 5
+while read -r w; do
+	got=$("$tarski" --rank $w >/dev/null 2>&1 && echo valid || echo invalid)
+	while read -r line; do
+		got="$got $("$tarski" --eval "${line#!}" $w 2>/dev/null)"
+	done <"$tmp/solve.txt"
+	expect "solve $w" "$got" "valid true true false true"
+done <"$tmp/solved.txt"
+printf 'Cube(a)\nTet(a)\n' >"$tmp/contradiction.txt"
+expect "solve contradiction" "$("$tarski" --solve "$tmp/contradiction.txt" 1 1-3 >/dev/null 2>&1; echo $?)" 2
+
+# Dense world IDs: unranking level 1 gives the worlds of the dumped level, rank
+# inverts unrank at both ends of levels 2 and 3 and in between, and IDs, levels
+# and worlds outside the tables are refused
+"$tarski" --unrank 1 0 24576 2>/dev/null | sort >"$tmp/unranked.txt"
+expect "unrank k=1" "$(tail -n +2 "$tmp/packed.txt" | sort | cmp -s - "$tmp/unranked.txt"; echo $?)" 0
+for id in "2 0" "2 12345678" "2 52907903" "3 0" "3 21540667237" "3 36861640703"; do
+	set -- $id
+	expect "rank unrank k=$1 $2" "$("$tarski" --rank $("$tarski" --unrank $1 $2 2>/dev/null) 2>/dev/null)" "$2"
+done
+expect "unrank past the level" "$("$tarski" --unrank 2 52907904 >/dev/null 2>&1; echo $?)" 1
+expect "unrank bad k" "$("$tarski" --unrank 13 0 >/dev/null 2>&1; echo $?)" 1
+expect "unrank bad id" "$("$tarski" --unrank 2 12x >/dev/null 2>&1; echo $?)" 1
+expect "rank invalid world" "$("$tarski" --rank 139265 139265 >/dev/null 2>&1; echo $?)" 1
+expect "rank non-object" "$("$tarski" --rank 262144 >/dev/null 2>&1; echo $?)" 1
+
+# Deduplication: a million draws of one object meet every class, and the 64 cells
+# fall into 10 classes under the board symmetries, so level 1 has 24576 worlds up
+# to order, 10 * 384 up to symmetry, 64 * 6 * 7 up to renaming (a body with 0 to 6
+# names) and 10 * 6 * 7 up to both; a full set refuses the rest
+for mode in "order 24576" "d4 3840" "labels 2688" "all 420"; do
+	set -- $mode
+	expect "dedup $1 k=1" "$("$tarski" --dedup 1 1000000 4 1 $1 2>/dev/null | awk '$1 == "Drawn:" { print $4 }')" $2
+done
+expect "dedup full set" "$("$tarski" --dedup 1 100000 4 1 order 1000 2>/dev/null | awk '$1 == "Drawn:" { print $4 }')" 1000
+
+# Library streaming: checklib splits levels 0..2 into lead ranges, where the pull
+# iterator, the push loop and the enumerate_level visitor must yield the same
+# worlds in the same order, as many as count_level counts
+if [ -n "$checklib" ]; then
+	"$checklib" >"$tmp/checklib.txt"
+	expect "library lines" "$(wc -l <"$tmp/checklib.txt" | tr -d ' ')" 15
+	while read -r kind k rest; do
+		set -- $rest
+		case $kind in
+		shard) expect "library k=$k leads $1" "$2 $3 $4 $5 $6" "$2 $2 $2 $2 yes" ;;
+		level) expect "library k=$k" "$1 $2" "$(nth $k "$level_dec") $(nth $k "$level_dec")" ;;
+		esac
+	done <"$tmp/checklib.txt"
+fi
+
+if [ $failures -ne 0 ]; then
+	echo "$failures checks failed"
+	exit 1
+fi
+echo "all checks passed"
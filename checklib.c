@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "libtarski.h"
+
+// checklib: cross-checks the streaming API of libtarski for make check. For each
+// small level, split into lead ranges, the pull iterator, the push loop and the
+// enumerate_level visitor must produce the same worlds in the same order, as many
+// as count_level counts for the range. Prints one line per range and level for
+// check.sh to compare:
+//   shard <k> <first>..<last> <iter> <blocks> <visited> <counted> <same order>
+//   level <k> <worlds over all ranges> <tarski_count_level>
+
+#define CHECK_MAX_OBJECTS 2
+#define CHECK_SHARDS 4
+
+struct stream_sum
+{
+	uint64_t worlds;
+	uint64_t hash;          // FNV-1a over the objects, in the order they came
+};
+
+// Effects: Folds num_worlds worlds of sizeof_w objects into s
+static void add_worlds(struct stream_sum* s, const uint32_t worlds[], int num_worlds, int sizeof_w)
+{
+	for(int i = 0; i < num_worlds * sizeof_w; i++)
+		s->hash = (s->hash ^ worlds[i]) * 0x100000001b3ULL;
+	s->worlds += num_worlds;
+}
+
+static void on_block(const uint32_t worlds[], int num_worlds, int sizeof_w, void* ctx)
+{
+	add_worlds(ctx, worlds, num_worlds, sizeof_w);
+}
+
+static void on_world(uint32_t w[], const int indices[], int sizeof_w, void* ctx)
+{
+	add_worlds(ctx, w, 1, sizeof_w);
+}
+
+int main(void)
+{
+	static uint32_t out[TARSKI_BLOCK_WORLDS * MAX_OBJECTS_IN_WORLD];
+	const uint32_t* objects = tarski_valid_objects();
+
+	for(int k = 0; k <= CHECK_MAX_OBJECTS; k++)
+	{
+		uint64_t total = 0;
+		for(int s = 0; s < CHECK_SHARDS; s++)
+		{
+			int first = s * NUM_VALID_OBJECTS / CHECK_SHARDS, last = (s + 1) * NUM_VALID_OBJECTS / CHECK_SHARDS;
+			struct stream_sum iter = { 0, 0xcbf29ce484222325ULL }, blocks = iter, visited = iter;
+			struct tarski_iter it;
+			struct bn count;
+			int n;
+
+			tarski_iter_init(&it, objects, NUM_VALID_OBJECTS, k, first, last);
+			while((n = tarski_iter_next(&it, out, TARSKI_BLOCK_WORLDS)) > 0)
+				add_worlds(&iter, out, n, k);
+			tarski_for_each_block(objects, NUM_VALID_OBJECTS, k, first, last, on_block, &blocks);
+			bignum_init(&count);
+			enumerate_level((uint32_t*)objects, k, first, last, &count, on_world, &visited);
+			bignum_init(&count);
+			count_level((uint32_t*)objects, k, first, last, &count);
+
+			bool same = iter.hash == blocks.hash && iter.hash == visited.hash;
+			printf("shard %d %d..%d %llu %llu %llu %llu %s\n", k, first, last, (unsigned long long)iter.worlds,
+				(unsigned long long)blocks.worlds, (unsigned long long)visited.worlds,
+				(unsigned long long)bignum_low64(&count), same ? "yes" : "no");
+			total += iter.worlds;
+		}
+
+		struct bn level;
+		tarski_count_level(k, &level);
+		printf("level %d %llu %llu\n", k, (unsigned long long)total, (unsigned long long)bignum_low64(&level));
+	}
+	return 0;
+}
@@ -0,0 +1,416 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include "bn.h"
+#include "tarski.h"
+#include "coordinator.h"
+
+// Respawns allowed per worker slot before the coordinator gives up on a level
+#define MAX_RESPAWNS_PER_WORKER 4
+
+// Connection state for one worker process
+struct worker_conn
+{
+	int fd;                 // -1 if the slot is free
+	bool busy;              // true while unit is outstanding
+	struct work_unit unit;
+};
+
+// Requires: fd is a valid descriptor, buf holds len bytes
+// Effects: Writes all of buf, retrying short writes. Returns false on error.
+static bool write_full(int fd, const void* buf, size_t len)
+{
+	const char* p = buf;
+	while(len)
+	{
+		ssize_t n = write(fd, p, len);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+// Requires: fd is a valid descriptor, buf has room for len bytes
+// Effects: Reads exactly len bytes. Returns false on error or end of file.
+static bool read_full(int fd, void* buf, size_t len)
+{
+	char* p = buf;
+	while(len)
+	{
+		ssize_t n = read(fd, p, len);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static bool socket_address(struct sockaddr_un* addr, const char* socket_path)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if(strlen(socket_path) >= sizeof(addr->sun_path))
+	{
+		fprintf(stderr, "Socket path too long: %s\n", socket_path);
+		return false;
+	}
+	strcpy(addr->sun_path, socket_path);
+	return true;
+}
+
+int listen_socket(const char* socket_path, int backlog)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+
+	if(!socket_address(&addr, socket_path))
+		return -1;
+
+	// Only a socket nobody answers on is ours to replace
+	if(lstat(socket_path, &st) == 0)
+	{
+		if(!S_ISSOCK(st.st_mode))
+		{
+			fprintf(stderr, "%s exists and is not a socket\n", socket_path);
+			return -1;
+		}
+		int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		bool live = probe >= 0 && connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+		if(probe >= 0)
+			close(probe);
+		if(live)
+		{
+			fprintf(stderr, "%s is in use by another server\n", socket_path);
+			return -1;
+		}
+		if(unlink(socket_path) < 0)
+		{
+			perror(socket_path);
+			return -1;
+		}
+	}
+	else if(errno != ENOENT)
+	{
+		perror(socket_path);
+		return -1;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+	{
+		perror("socket");
+		return -1;
+	}
+	if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0)
+	{
+		perror("bind");
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// Effects: Starts "tarski --worker socket_path" as a child process, returns its pid or -1
+static pid_t spawn_worker(const char* socket_path)
+{
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		execl("/proc/self/exe", "tarski", "--worker", socket_path, (char*)NULL);
+		perror("execl");
+		_exit(127);
+	}
+	return pid;
+}
+
+int run_worker(const char* socket_path)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	if(!socket_address(&addr, socket_path))
+		return 1;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+	{
+		perror("socket");
+		return 1;
+	}
+	if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+	{
+		perror("connect");
+		close(fd);
+		return 1;
+	}
+
+	struct work_unit unit;
+	struct work_result result;
+
+	// One unit at a time: the coordinator only sends the next one after our result
+	while(read_full(fd, &unit, sizeof(unit)))
+	{
+		if(unit.objects_in_world < 0)
+			break;
+
+		result.unit = unit;
+		bignum_init(&result.count);
+		count_level_by_cell(unit.objects_in_world, unit.lead, unit.lead + 1, &result.count);
+
+		if(!write_full(fd, &result, sizeof(result)))
+			break;
+	}
+
+	close(fd);
+	return 0;
+}
+
+// Queue of units still to hand out: a generator over (level, lead) plus a
+// stack of units taken back from workers that died
+struct unit_queue
+{
+	int max_objects;
+	struct work_unit next;
+	struct work_unit* retry;
+	int retry_len;
+	int retry_cap;
+};
+
+static bool queue_pop(struct unit_queue* q, struct work_unit* unit)
+{
+	if(q->retry_len)
+	{
+		*unit = q->retry[--q->retry_len];
+		return true;
+	}
+	if(q->next.objects_in_world > q->max_objects)
+		return false;
+
+	*unit = q->next;
+
+	// Level 0 only has the empty world, every other level has one unit per possible lead
+	int last_lead = q->next.objects_in_world ? NUM_VALID_OBJECTS - q->next.objects_in_world : 0;
+	if(q->next.lead >= last_lead)
+	{
+		q->next.objects_in_world++;
+		q->next.lead = 0;
+	}
+	else
+		q->next.lead++;
+	return true;
+}
+
+static void queue_push_retry(struct unit_queue* q, struct work_unit unit)
+{
+	if(q->retry_len == q->retry_cap)
+	{
+		q->retry_cap = q->retry_cap ? 2 * q->retry_cap : 16;
+		q->retry = realloc(q->retry, q->retry_cap * sizeof(*q->retry));
+		if(!q->retry)
+		{
+			perror("realloc");
+			exit(1);
+		}
+	}
+	q->retry[q->retry_len++] = unit;
+}
+
+// Effects: Sends the next unit to w, or marks it idle if nothing is left
+static void assign_unit(struct worker_conn* w, struct unit_queue* q)
+{
+	if(!queue_pop(q, &w->unit))
+	{
+		w->busy = false;
+		return;
+	}
+	w->busy = true;
+	if(!write_full(w->fd, &w->unit, sizeof(w->unit)))
+	{
+		// The read side will see the hang-up and requeue the unit
+		return;
+	}
+}
+
+int run_coordinator(int workers, int max_objects, const char* socket_path)
+{
+	char default_path[108];
+
+	if(workers <= 0)
+		workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(workers <= 0)
+		workers = 1;
+	if(max_objects < 0 || max_objects > MAX_OBJECTS_IN_WORLD)
+		max_objects = MAX_OBJECTS_IN_WORLD;
+	if(!socket_path)
+	{
+		snprintf(default_path, sizeof(default_path), "/tmp/tarski-%d.sock", (int)getpid());
+		socket_path = default_path;
+	}
+
+	// A dead worker must show up as a hang-up, not kill us on the next write
+	signal(SIGPIPE, SIG_IGN);
+
+	int listen_fd = listen_socket(socket_path, workers);
+	if(listen_fd < 0)
+		return 1;
+
+	struct worker_conn* conns = calloc(workers, sizeof(*conns));
+	struct pollfd* fds = calloc(workers + 1, sizeof(*fds));
+	struct bn* level_count = calloc(max_objects + 1, sizeof(*level_count));
+	if(!conns || !fds || !level_count)
+	{
+		perror("calloc");
+		return 1;
+	}
+	for(int i = 0; i < workers; i++)
+		conns[i].fd = -1;
+
+	struct unit_queue queue = { max_objects, { 0, 0 }, NULL, 0, 0 };
+
+	int alive = 0;
+	int respawns = 0;
+	for(int i = 0; i < workers; i++)
+		if(spawn_worker(socket_path) > 0)
+			alive++;
+
+	int status = 0;
+	while(true)
+	{
+		bool outstanding = false;
+		int connected = 0;
+		for(int i = 0; i < workers; i++)
+		{
+			if(conns[i].fd >= 0) connected++;
+			if(conns[i].fd >= 0 && conns[i].busy) outstanding = true;
+		}
+		if(!outstanding && queue.retry_len == 0 && queue.next.objects_in_world > max_objects)
+			break;
+
+		// Reap dead children and replace them while work remains
+		pid_t pid;
+		int wstatus;
+		while((pid = waitpid(-1, &wstatus, WNOHANG)) > 0)
+		{
+			alive--;
+			if(respawns < MAX_RESPAWNS_PER_WORKER * workers)
+			{
+				if(spawn_worker(socket_path) > 0)
+					alive++;
+				respawns++;
+			}
+		}
+		if(alive == 0 && connected == 0)
+		{
+			fprintf(stderr, "All workers died, giving up\n");
+			status = 1;
+			break;
+		}
+
+		fds[0].fd = listen_fd;
+		fds[0].events = POLLIN;
+		for(int i = 0; i < workers; i++)
+		{
+			fds[i + 1].fd = conns[i].fd;
+			fds[i + 1].events = POLLIN;
+			fds[i + 1].revents = 0;
+		}
+
+		// Wake up periodically to notice workers that died before connecting
+		if(poll(fds, workers + 1, 200) < 0)
+		{
+			if(errno == EINTR) continue;
+			perror("poll");
+			status = 1;
+			break;
+		}
+
+		if(fds[0].revents & POLLIN)
+		{
+			int fd = accept(listen_fd, NULL, NULL);
+			int slot = -1;
+			for(int i = 0; i < workers && fd >= 0; i++)
+				if(conns[i].fd < 0) { slot = i; break; }
+			if(slot < 0)
+			{
+				if(fd >= 0) close(fd);
+			}
+			else
+			{
+				conns[slot].fd = fd;
+				assign_unit(&conns[slot], &queue);
+			}
+		}
+
+		for(int i = 0; i < workers; i++)
+		{
+			struct worker_conn* w = &conns[i];
+			if(w->fd < 0 || !(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+
+			struct work_result result;
+			if(read_full(w->fd, &result, sizeof(result)) && w->busy
+				&& result.unit.objects_in_world == w->unit.objects_in_world && result.unit.lead == w->unit.lead)
+			{
+				bignum_add(&level_count[result.unit.objects_in_world], &result.count, &level_count[result.unit.objects_in_world]);
+				assign_unit(w, &queue);
+				continue;
+			}
+
+			// Worker crashed or sent garbage: re-issue whatever it was holding
+			if(w->busy)
+				queue_push_retry(&queue, w->unit);
+			close(w->fd);
+			w->fd = -1;
+			w->busy = false;
+		}
+
+		// Hand re-issued units to idle workers
+		for(int i = 0; i < workers; i++)
+			if(conns[i].fd >= 0 && !conns[i].busy && queue.retry_len)
+				assign_unit(&conns[i], &queue);
+	}
+
+	// Tell everyone to exit and collect them
+	struct work_unit stop = { -1, 0 };
+	for(int i = 0; i < workers; i++)
+	{
+		if(conns[i].fd < 0) continue;
+		write_full(conns[i].fd, &stop, sizeof(stop));
+		close(conns[i].fd);
+	}
+	while(alive > 0 && wait(NULL) > 0)
+		alive--;
+	close(listen_fd);
+	unlink(socket_path);
+
+	if(status == 0)
+	{
+		// Same running total per level as the single process enumeration
+		struct bn final_count;
+		bignum_from_int(&final_count, 0);
+		for(int k = 0; k <= max_objects; k++)
+		{
+			bignum_add(&final_count, &level_count[k], &final_count);
+			printf("Objects in world: %d \n", k);
+			print_bignum(&final_count);
+		}
+	}
+
+	free(queue.retry);
+	free(level_count);
+	free(fds);
+	free(conns);
+	return status;
+}
@@ -0,0 +1,45 @@
+#ifndef __COORDINATOR_H__
+#define __COORDINATOR_H__
+
+#include <stdint.h>
+#include "bn.h"
+
+// Multi-process counting over a Unix domain socket.
+//
+// The coordinator splits every objects_in_world level into work units, one per
+// lead index (the index of a world's first object in the cell order that
+// count_level_by_cell counts over), and hands them out to
+// "tarski --worker <socket>" processes. A unit held by a worker that dies is put
+// back on the queue and the worker is respawned, so only the lost unit is redone.
+
+// Sent coordinator -> worker. objects_in_world < 0 tells the worker to exit.
+struct work_unit
+{
+	int32_t objects_in_world;
+	int32_t lead;
+};
+
+// Sent worker -> coordinator once the unit has been counted
+struct work_result
+{
+	struct work_unit unit;
+	struct bn count;
+};
+
+// Requires: workers >= 0 (0 picks the number of online CPUs),
+//   0 <= max_objects <= MAX_OBJECTS_IN_WORLD, socket_path may be NULL
+// Effects: Counts levels 0..max_objects with worker processes, prints the
+//   running total per level like main(). Returns the process exit status.
+int run_coordinator(int workers, int max_objects, const char* socket_path);
+
+// Effects: Binds and listens on a Unix socket at socket_path. An existing path is
+//   replaced only if it is a socket that refuses connections (left behind by a
+//   dead server); a live socket or any other file is an error. Returns the
+//   listening fd, or -1 after printing the reason.
+int listen_socket(const char* socket_path, int backlog);
+
+// Requires: socket_path names a listening coordinator socket
+// Effects: Serves work units until told to exit or the socket closes
+int run_worker(const char* socket_path);
+
+#endif /* #ifndef __COORDINATOR_H__ */
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <string.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+
+void bignum_mul_int(struct bn* a, DTYPE_TMP b, struct bn* c)
+{
+	require(b <= MAX_VAL, "multiplier must fit in one word");
+
+	DTYPE_TMP carry = 0;
+	for(int i = 0; i < BN_ARRAY_SIZE; i++)
+	{
+		DTYPE_TMP tmp = (DTYPE_TMP)a->array[i] * b + carry;
+		c->array[i] = (DTYPE)tmp;
+		carry = tmp >> (8 * WORD_SIZE);
+	}
+}
+
+// Returns: number of words up to and including the highest non-zero one
+static int bignum_used_words(const struct bn* a)
+{
+	int n = BN_ARRAY_SIZE;
+	while(n > 0 && a->array[n - 1] == 0)
+		n--;
+	return n;
+}
+
+void bignum_mul_words(const struct bn* a, const struct bn* b, struct bn* c)
+{
+	// Schoolbook multiplication over the used words only; bignum_mul() always
+	// walks the full array, which dominates the cost of small table products
+	struct bn r;
+	int na = bignum_used_words(a);
+	int nb = bignum_used_words(b);
+
+	bignum_init(&r);
+	for(int i = 0; i < na; i++)
+	{
+		DTYPE_TMP carry = 0;
+		for(int j = 0; j < nb && i + j < BN_ARRAY_SIZE; j++)
+		{
+			DTYPE_TMP tmp = (DTYPE_TMP)a->array[i] * b->array[j] + r.array[i + j] + carry;
+			r.array[i + j] = (DTYPE)tmp;
+			carry = tmp >> (8 * WORD_SIZE);
+		}
+		if(i + nb < BN_ARRAY_SIZE)
+			r.array[i + nb] = (DTYPE)carry;
+	}
+	bignum_assign(c, &r);
+}
+
+void bignum_to_decimal(struct bn* n, char* str, int maxsize)
+{
+	// Short division by 10^9 from the top word down, collecting 9 digits at a time
+	struct bn q;
+	uint32_t chunks[BN_ARRAY_SIZE * 2];
+	int nchunks = 0;
+
+	bignum_assign(&q, n);
+	do
+	{
+		DTYPE_TMP rem = 0;
+		for(int i = BN_ARRAY_SIZE - 1; i >= 0; i--)
+		{
+			DTYPE_TMP cur = (rem << (8 * WORD_SIZE)) | q.array[i];
+			q.array[i] = (DTYPE)(cur / 1000000000u);
+			rem = cur % 1000000000u;
+		}
+		chunks[nchunks++] = (uint32_t)rem;
+	} while(!bignum_is_zero(&q));
+
+	int len = snprintf(str, maxsize, "%u", chunks[nchunks - 1]);
+	for(int i = nchunks - 2; i >= 0 && len < maxsize; i--)
+		len += snprintf(str + len, maxsize - len, "%09u", chunks[i]);
+}
+
+void bignum_from_u128(unsigned __int128 v, struct bn* out)
+{
+	struct bn lo, hi;
+	bignum_from_int(&hi, (uint64_t)(v >> 64));
+	bignum_lshift(&hi, out, 64);
+	bignum_from_int(&lo, (uint64_t)v);
+	bignum_add(out, &lo, out);
+}
+
+uint64_t bignum_low64(const struct bn* n)
+{
+	uint64_t v = 0;
+	for(int i = 8 / WORD_SIZE - 1; i >= 0; i--)
+		v = (v << (8 * WORD_SIZE)) | n->array[i];
+	return v;
+}
+
+void world_filter_all(struct world_filter* f)
+{
+	f->sizes = ALL_SIZES;
+	f->shapes = ALL_SHAPES;
+	f->names = ALL_LABELS;
+	f->required = 0;
+	f->region = ALL_CELLS;
+}
+
+bool count_tables_build(struct count_tables* t, const uint32_t valid_objects[], int num_valid_objects)
+{
+	memset(t, 0, sizeof(*t));
+
+	// Collect which (size, shape) pairs exist
+	for(int i = 0; i < num_valid_objects; i++)
+	{
+		uint32_t o = valid_objects[i];
+		int size = __builtin_ctz(OBJECT_SIZE(o));
+		int shape = __builtin_ctz(OBJECT_SHAPE(o));
+		if(OBJECT_SIZE(o) & 1)
+			return false; // Large objects occupy their neighbours, cells are no longer independent
+		t->attrs[size] |= 1 << shape;
+	}
+	for(int s = 0; s < NUM_SIZES; s++)
+		t->num_attrs += __builtin_popcount(t->attrs[s]);
+
+	// valid_objects holds distinct objects, so this many of them means every
+	// attribute pair appears on every cell with every label mask
+	if(num_valid_objects != t->num_attrs * NUM_CELLS * 64)
+		return false;
+
+	// Pascal's triangle, truncated at MAX_OBJECTS_IN_WORLD
+	for(int n = 0; n <= NUM_CELLS; n++)
+	{
+		for(int r = 0; r <= MAX_OBJECTS_IN_WORLD; r++)
+		{
+			if(r == 0)
+				bignum_from_int(&t->binom[n][r], 1);
+			else if(n == 0)
+				bignum_init(&t->binom[n][r]);
+			else
+				bignum_add(&t->binom[n - 1][r - 1], &t->binom[n - 1][r], &t->binom[n][r]);
+		}
+	}
+
+	for(int a = 0; a <= NUM_ATTRS; a++)
+	{
+		bignum_from_int(&t->power[a][0], 1);
+		for(int e = 1; e <= MAX_OBJECTS_IN_WORLD; e++)
+			bignum_mul_int(&t->power[a][e - 1], a, &t->power[a][e]);
+	}
+
+	// Each required name goes to one of k objects, every other allowed name to
+	// one of k objects or nowhere
+	for(int k = 0; k <= MAX_OBJECTS_IN_WORLD; k++)
+	{
+		for(int m = 0; m <= NUM_LABELS; m++)
+		{
+			for(int r = 0; r <= m; r++)
+			{
+				struct bn* w = &t->label_ways[k][m][r];
+				bignum_from_int(w, 1);
+				for(int i = 0; i < r; i++)
+					bignum_mul_int(w, k, w);
+				for(int i = r; i < m; i++)
+					bignum_mul_int(w, k + 1, w);
+			}
+		}
+	}
+	return true;
+}
+
+int count_filter_attrs(const struct count_tables* t, const struct world_filter* f)
+{
+	int a = 0;
+	for(int s = 0; s < NUM_SIZES; s++)
+		if((f->sizes >> s) & 1)
+			a += __builtin_popcount(t->attrs[s] & f->shapes);
+	return a;
+}
+
+void count_worlds(const struct count_tables* t, int objects_in_world, const struct world_filter* f, struct bn* out)
+{
+	int k = objects_in_world;
+	int cells = __builtin_popcountll(f->region);
+	int m = __builtin_popcount(f->names & ALL_LABELS);
+	int r = __builtin_popcount(f->required & ALL_LABELS);
+
+	// A required name no object may carry can never be used
+	if(f->required & ~f->names)
+	{
+		bignum_init(out);
+		return;
+	}
+
+	struct bn tmp;
+	bignum_mul_words(&t->binom[cells][k], &t->power[count_filter_attrs(t, f)][k], &tmp);
+	bignum_mul_words(&tmp, &t->label_ways[k][m][r], out);
+}
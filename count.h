@@ -0,0 +1,84 @@
+#ifndef __COUNT_H__
+#define __COUNT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bn.h"
+#include "tarski.h"
+
+// Counting tables: exact world counts without enumeration.
+//
+// valid_objects has no large objects, so location_check_v2() reduces to "no two
+// centers on the same cell", and letter_check() to "label masks are pairwise
+// disjoint". Every valid object exists on every cell with every label mask, so a
+// valid k-world is exactly
+//   - a k-subset of the board cells (objects sorted by cell),
+//   - one (size, shape) pair per object, in cell order,
+//   - for each name a-f: the object carrying it, or none.
+// Counts under a filter are then products of binomials and powers, which the
+// tables below hold as struct bn.
+
+#define NUM_CELLS 64
+#define NUM_LABELS 6
+#define NUM_SIZES 3   // index 0 = Large (bit 15), 1 = Medium (bit 16), 2 = Small (bit 17)
+#define NUM_SHAPES 3  // index 0 = Dodecahedron (bit 12), 1 = Cube (bit 13), 2 = Tetrahedron (bit 14)
+#define NUM_ATTRS (NUM_SIZES * NUM_SHAPES)
+
+#define ALL_SIZES 7
+#define ALL_SHAPES 7
+#define ALL_LABELS 63
+#define ALL_CELLS UINT64_MAX
+
+// Field accessors for the packed object encoding
+#define OBJECT_LABELS(o) ((o) & 63)
+#define OBJECT_CELL(o)   (((o) >> 6) & 63)
+#define OBJECT_SHAPE(o)  (((o) >> 12) & 7)  // one-hot, bit i = shape index i
+#define OBJECT_SIZE(o)   (((o) >> 15) & 7)  // one-hot, bit i = size index i
+#define CELL_X(c) ((c) >> 3)
+#define CELL_Y(c) ((c) & 7)
+
+// Constraints every object of a counted world must satisfy. A world counts if
+// all of its objects pass the filter and it uses every name in required.
+struct world_filter
+{
+	uint8_t sizes;    // allowed sizes, bit i = size index i
+	uint8_t shapes;   // allowed shapes, bit i = shape index i
+	uint8_t names;    // names objects may carry, bit i = name 'a' + i
+	uint8_t required; // names that must appear in the world
+	uint64_t region;  // allowed cells, bit c = cell c
+};
+
+struct count_tables
+{
+	// attrs[size] = mask of shapes that exist in valid_objects for that size
+	uint8_t attrs[NUM_SIZES];
+	int num_attrs;
+
+	struct bn binom[NUM_CELLS + 1][MAX_OBJECTS_IN_WORLD + 1];              // C(n, r)
+	struct bn power[NUM_ATTRS + 1][MAX_OBJECTS_IN_WORLD + 1];              // a^e
+	struct bn label_ways[MAX_OBJECTS_IN_WORLD + 1][NUM_LABELS + 1][NUM_LABELS + 1]; // k^r * (k+1)^(m-r)
+};
+
+// Effects: Sets f to accept every valid object
+void world_filter_all(struct world_filter* f);
+
+// Effects: Fills t from valid_objects. Returns false if valid_objects does not
+//   have the product structure described above (e.g. large objects enabled).
+bool count_tables_build(struct count_tables* t, const uint32_t valid_objects[], int num_valid_objects);
+
+// Returns: the number of (size, shape) pairs f allows for one object
+int count_filter_attrs(const struct count_tables* t, const struct world_filter* f);
+
+// Requires: 0 <= objects_in_world <= MAX_OBJECTS_IN_WORLD
+// Modifies: *out
+// Effects: *out = number of valid worlds of objects_in_world objects passing f
+void count_worlds(const struct count_tables* t, int objects_in_world, const struct world_filter* f, struct bn* out);
+
+// Helpers for small multipliers, conversions and decimal output of struct bn
+void bignum_mul_int(struct bn* a, DTYPE_TMP b, struct bn* c);       // c = a * b
+void bignum_mul_words(const struct bn* a, const struct bn* b, struct bn* c); // c = a * b, cost ~ used words
+void bignum_from_u128(unsigned __int128 v, struct bn* out);        // out = v
+uint64_t bignum_low64(const struct bn* n);                         // n mod 2^64
+void bignum_to_decimal(struct bn* n, char* str, int maxsize);
+
+#endif /* #ifndef __COUNT_H__ */
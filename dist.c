@@ -0,0 +1,101 @@
+#include <string.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+#include "dist.h"
+
+void dist_build(struct world_dist* d, const struct count_tables* t)
+{
+	memset(d, 0, sizeof(*d));
+
+	for(int k = 0; k <= MAX_OBJECTS_IN_WORLD; k++)
+	{
+		// C(64, k) by the multiplicative formula; every step stays exact
+		d->cells[k] = 1;
+		for(int i = 1; i <= k; i++)
+			d->cells[k] = d->cells[k] * (NUM_CELLS - k + i) / i;
+
+		uint64_t choose = 1, power = 1;
+		for(int u = 0; u <= NUM_LABELS; u++)
+		{
+			d->names[k][u] = choose * power;
+			choose = choose * (NUM_LABELS - u) / (u + 1);
+			power *= k;
+		}
+	}
+
+	// One object at a time: each sequence of k pairs extends by every pair
+	d->attrs[0][0][0][0][0] = 1;
+	for(int k = 0; k < MAX_OBJECTS_IN_WORLD; k++)
+	{
+		for(int s0 = 0; s0 <= k; s0++)
+		for(int s1 = 0; s0 + s1 <= k; s1++)
+		for(int z0 = 0; z0 <= k; z0++)
+		for(int z1 = 0; z0 + z1 <= k; z1++)
+		{
+			uint64_t ways = d->attrs[k][s0][s1][z0][z1];
+			if(!ways)
+				continue;
+			for(int size = 0; size < NUM_SIZES; size++)
+			{
+				for(int shape = 0; shape < NUM_SHAPES; shape++)
+				{
+					if(!((t->attrs[size] >> shape) & 1))
+						continue;
+					d->attrs[k + 1][s0 + (shape == 0)][s1 + (shape == 1)][z0 + (size == 0)][z1 + (size == 1)] += ways;
+				}
+			}
+		}
+	}
+}
+
+void dist_query_any(struct dist_query* q)
+{
+	q->objects = DIST_ANY;
+	for(int i = 0; i < NUM_SHAPES; i++)
+		q->shapes[i] = DIST_ANY;
+	for(int i = 0; i < NUM_SIZES; i++)
+		q->sizes[i] = DIST_ANY;
+	q->names = DIST_ANY;
+}
+
+// Returns: true if count c matches query value v
+static inline bool matches(int v, int c)
+{
+	return v == DIST_ANY || v == c;
+}
+
+void dist_count(const struct world_dist* d, const struct dist_query* q, struct bn* count)
+{
+	bignum_init(count);
+	for(int k = 0; k <= MAX_OBJECTS_IN_WORLD; k++)
+	{
+		if(!matches(q->objects, k))
+			continue;
+
+		uint64_t attrs = 0, names = 0;
+		for(int s0 = 0; s0 <= k; s0++)
+		for(int s1 = 0; s0 + s1 <= k; s1++)
+		for(int z0 = 0; z0 <= k; z0++)
+		for(int z1 = 0; z0 + z1 <= k; z1++)
+		{
+			if(matches(q->shapes[0], s0) && matches(q->shapes[1], s1) && matches(q->shapes[2], k - s0 - s1)
+				&& matches(q->sizes[0], z0) && matches(q->sizes[1], z1) && matches(q->sizes[2], k - z0 - z1))
+				attrs += d->attrs[k][s0][s1][z0][z1];
+		}
+		for(int u = 0; u <= NUM_LABELS; u++)
+			if(matches(q->names, u))
+				names += d->names[k][u];
+		if(!attrs || !names)
+			continue;
+
+		// C(64, k) * attrs * names; the last two may overflow 64 bits together
+		struct bn a, b, term;
+		bignum_from_int(&a, d->cells[k]);
+		bignum_from_int(&b, attrs);
+		bignum_mul_words(&a, &b, &term);
+		bignum_from_int(&b, names);
+		bignum_mul_words(&term, &b, &a);
+		bignum_add(count, &a, count);
+	}
+}
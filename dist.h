@@ -0,0 +1,60 @@
+#ifndef __DIST_H__
+#define __DIST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+
+// Distribution of the valid worlds by number of objects, objects of each shape,
+// objects of each size and names used.
+//
+// Under the product structure of count.h the three parts of a world are chosen
+// independently, so the number of worlds with k objects, shape counts s, size
+// counts z and u names used is
+//   C(64, k) * A(k, s, z) * C(6, u) * k^u
+// where A(k, s, z) counts the sequences of k (size, shape) pairs, among the pairs
+// valid_objects has, with those shape and size counts. Every factor fits in 64
+// bits; the table holds the factors and multiplies them out as struct bn when
+// queried. Since a query fixes or frees each dimension on its own, its count at
+// one k is the product of the sums of the matching factors, so any marginal or
+// joint count costs at most one pass over A(k, ., .).
+
+// A query: each field is a value to match or DIST_ANY
+#define DIST_ANY -1
+
+struct dist_query
+{
+	int objects;
+	int shapes[NUM_SHAPES];         // objects of each shape index
+	int sizes[NUM_SIZES];           // objects of each size index
+	int names;                      // names used, 0..6
+};
+
+// A(k, s, z) indexed by the first two shape counts and the first two size counts;
+// the third of each is k minus the other two
+typedef uint64_t dist_attr_table[MAX_OBJECTS_IN_WORLD + 1][MAX_OBJECTS_IN_WORLD + 1]
+	[MAX_OBJECTS_IN_WORLD + 1][MAX_OBJECTS_IN_WORLD + 1];
+
+struct world_dist
+{
+	uint64_t cells[MAX_OBJECTS_IN_WORLD + 1];                       // C(64, k)
+	uint64_t names[MAX_OBJECTS_IN_WORLD + 1][NUM_LABELS + 1];       // C(6, u) * k^u
+	dist_attr_table attrs[MAX_OBJECTS_IN_WORLD + 1];
+};
+
+// Requires: t was built by count_tables_build()
+// Effects: Fills d for every k up to MAX_OBJECTS_IN_WORLD. d is large (about
+//   3 MB); allocate it on the heap.
+void dist_build(struct world_dist* d, const struct count_tables* t);
+
+// Effects: Sets every field of q to DIST_ANY
+void dist_query_any(struct dist_query* q);
+
+// Modifies: *count
+// Effects: *count = number of valid worlds matching q, over all k if q->objects is
+//   DIST_ANY
+void dist_count(const struct world_dist* d, const struct dist_query* q, struct bn* count);
+
+#endif /* #ifndef __DIST_H__ */
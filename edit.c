@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tarski.h"
+#include "count.h"
+#include "sentence.h"
+#include "edit.h"
+
+// Returns: EDIT_* attributes predicate pred reads from its arguments
+static int pred_attrs(int pred)
+{
+	switch(pred)
+	{
+		case PRED_TET:
+		case PRED_CUBE:
+		case PRED_DODEC:
+		case PRED_SAMESHAPE:
+			return EDIT_SHAPE;
+		case PRED_SMALL:
+		case PRED_MEDIUM:
+		case PRED_LARGE:
+		case PRED_SAMESIZE:
+		case PRED_LARGER:
+		case PRED_SMALLER:
+			return EDIT_SIZE;
+		case PRED_EQUAL:
+			return 0;
+	}
+	return EDIT_POSITION;
+}
+
+void sentence_deps_build(const struct sentence* s, struct sentence_deps* d)
+{
+	memset(d, 0, sizeof(*d));
+
+	for(int n = 0; n < s->num_nodes; n++)
+	{
+		const struct sentence_node* node = &s->nodes[n];
+		if(node->op == OP_FORALL || node->op == OP_EXISTS)
+			d->quantified = true;
+		if(node->op != OP_ATOM)
+			continue;
+		int attrs = pred_attrs(node->pred);
+		for(int i = 0; i < (node->pred == PRED_BETWEEN ? 3 : node->pred <= PRED_LARGE ? 1 : 2); i++)
+		{
+			if(node->arg[i] >= TERM_VAR)
+				d->var_attrs |= attrs;
+			else
+				d->name_attrs[node->arg[i]] |= attrs;
+		}
+	}
+
+	// A name means whichever object carries it, and the sentence is undefined
+	// without it, so moving a name always matters
+	for(int n = 0; n < NUM_LABELS; n++)
+		if((s->names >> n) & 1)
+			d->name_attrs[n] |= EDIT_LABELS;
+}
+
+int object_changes(uint32_t a, uint32_t b)
+{
+	int changes = 0;
+	if(OBJECT_CELL(a) != OBJECT_CELL(b))
+		changes |= EDIT_POSITION;
+	if(OBJECT_SHAPE(a) != OBJECT_SHAPE(b))
+		changes |= EDIT_SHAPE;
+	if(OBJECT_SIZE(a) != OBJECT_SIZE(b))
+		changes |= EDIT_SIZE;
+	if(OBJECT_LABELS(a) != OBJECT_LABELS(b))
+		changes |= EDIT_LABELS;
+	return changes;
+}
+
+// Returns: conflicts between object slot and every other object
+static int slot_conflicts(const struct world_editor* ed, int slot, uint32_t o)
+{
+	int conflicts = 0;
+	for(int i = 0; i < ed->num_objects; i++)
+		if(i != slot && objects_conflict(o, ed->w[i]))
+			conflicts++;
+	return conflicts;
+}
+
+// Returns: true if sentence d can change when an object carrying old_labels
+//   before and new_labels after has the attributes in changes modified
+static bool affected(const struct sentence_deps* d, int changes, uint8_t old_labels, uint8_t new_labels)
+{
+	if(d->var_attrs & changes)
+		return true;
+	for(uint8_t l = old_labels | new_labels; l; l &= l - 1)
+	{
+		int n = __builtin_ctz(l);
+		bool moved = ((old_labels ^ new_labels) >> n) & 1;
+		if(d->name_attrs[n] & (moved ? EDIT_ALL : changes))
+			return true;
+	}
+	return false;
+}
+
+// Effects: Reloads the decoded world and re-evaluates the sentences an edit can affect
+static int reevaluate(struct world_editor* ed, int changes, uint8_t old_labels, uint8_t new_labels, bool resized)
+{
+	int count = 0;
+
+	eval_world_load(&ed->ew, ed->w, ed->num_objects);
+	for(int i = 0; i < ed->num_sentences; i++)
+	{
+		const struct sentence_deps* d = &ed->deps[i];
+		if(!(resized && d->quantified) && !affected(d, changes, old_labels, new_labels))
+			continue;
+		ed->values[i] = sentence_eval(&ed->sentences[i], &ed->ew);
+		count++;
+	}
+	ed->evaluations += count;
+	return count;
+}
+
+bool editor_init(struct world_editor* ed, const struct sentence sentences[], int num_sentences,
+	const uint32_t w[], int num_objects)
+{
+	memset(ed, 0, sizeof(*ed));
+	ed->sentences = sentences;
+	ed->num_sentences = num_sentences;
+	ed->deps = malloc(num_sentences * sizeof(*ed->deps) + 1);
+	ed->values = malloc(num_sentences + 1);
+	if(!ed->deps || !ed->values)
+	{
+		editor_free(ed);
+		return false;
+	}
+
+	for(int i = 0; i < num_objects; i++)
+	{
+		ed->w[i] = w[i];
+		ed->conflicts += slot_conflicts(ed, i, w[i]);
+		ed->num_objects++;
+	}
+	for(int i = 0; i < num_sentences; i++)
+		sentence_deps_build(&sentences[i], &ed->deps[i]);
+
+	// Every sentence once
+	eval_world_load(&ed->ew, ed->w, ed->num_objects);
+	for(int i = 0; i < num_sentences; i++)
+		ed->values[i] = sentence_eval(&sentences[i], &ed->ew);
+	ed->evaluations = num_sentences;
+	return true;
+}
+
+void editor_free(struct world_editor* ed)
+{
+	free(ed->deps);
+	free(ed->values);
+	ed->deps = NULL;
+	ed->values = NULL;
+}
+
+int editor_set(struct world_editor* ed, int slot, uint32_t o)
+{
+	if(slot < 0 || slot >= ed->num_objects)
+		return -1;
+
+	uint32_t old = ed->w[slot];
+	int changes = object_changes(old, o);
+	if(!changes)
+		return 0;
+
+	ed->conflicts += slot_conflicts(ed, slot, o) - slot_conflicts(ed, slot, old);
+	ed->w[slot] = o;
+	return reevaluate(ed, changes, OBJECT_LABELS(old), OBJECT_LABELS(o), false);
+}
+
+int editor_add(struct world_editor* ed, uint32_t o)
+{
+	if(ed->num_objects == MAX_OBJECTS_IN_WORLD)
+		return -1;
+
+	ed->conflicts += slot_conflicts(ed, ed->num_objects, o);
+	ed->w[ed->num_objects++] = o;
+	return reevaluate(ed, 0, 0, OBJECT_LABELS(o), true);
+}
+
+int editor_remove(struct world_editor* ed, int slot)
+{
+	if(slot < 0 || slot >= ed->num_objects)
+		return -1;
+
+	uint32_t old = ed->w[slot];
+	uint32_t last = ed->w[ed->num_objects - 1];
+	ed->conflicts -= slot_conflicts(ed, slot, old);
+	ed->w[slot] = last;
+	ed->num_objects--;
+	// In a world with a name on two objects the later one carries it, so the
+	// object changing slots may change what its names refer to
+	return reevaluate(ed, 0, OBJECT_LABELS(old) | OBJECT_LABELS(last), 0, true);
+}
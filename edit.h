@@ -0,0 +1,77 @@
+#ifndef __EDIT_H__
+#define __EDIT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tarski.h"
+#include "sentence.h"
+
+// Incremental checking of a world under single-object edits.
+//
+// Each sentence is summarised by the attributes its atoms read, split by how the
+// object is reached: through a name (name_attrs[n]) or through a bound variable
+// (var_attrs, which may be any object). An edit changes some attributes of one
+// object; a sentence is re-evaluated only if it reads one of them through a name
+// the object carries (before or after), or through a variable. Adding or
+// removing an object re-evaluates quantified sentences and those naming it.
+//
+// Validity is kept as a count of conflicting pairs (overlapping placement or
+// shared labels), so an edit re-checks the edited object against the k - 1 others
+// instead of re-running check_world on the whole world.
+
+#define EDIT_POSITION 1
+#define EDIT_SHAPE 2
+#define EDIT_SIZE 4
+#define EDIT_LABELS 8   // which object carries a name; also identity (a = b)
+#define EDIT_ALL 15
+
+struct sentence_deps
+{
+	uint8_t name_attrs[6];  // EDIT_* read through each name
+	uint8_t var_attrs;      // EDIT_* read through bound variables
+	bool quantified;
+};
+
+struct world_editor
+{
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+	int num_objects;
+	int conflicts;            // conflicting pairs of objects
+	struct eval_world ew;
+	const struct sentence* sentences;
+	int num_sentences;
+	struct sentence_deps* deps;
+	int8_t* values;           // enum sentence_value of each sentence
+	uint64_t evaluations;     // sentence evaluations since editor_init
+};
+
+// Effects: Fills d from the atoms of s
+void sentence_deps_build(const struct sentence* s, struct sentence_deps* d);
+
+// Returns: EDIT_* attributes that differ between packed objects a and b
+int object_changes(uint32_t a, uint32_t b);
+
+// Requires: sentences stays alive while the editor is used, num_objects <= MAX_OBJECTS_IN_WORLD
+// Effects: Starts editing w and evaluates every sentence. Returns false on allocation failure.
+bool editor_init(struct world_editor* ed, const struct sentence sentences[], int num_sentences,
+	const uint32_t w[], int num_objects);
+void editor_free(struct world_editor* ed);
+
+// Returns: true if the current world passes check_world
+static inline bool editor_valid(const struct world_editor* ed)
+{
+	return ed->conflicts == 0;
+}
+
+// Effects: Replaces object slot with o and re-evaluates the affected sentences.
+//   Returns the number of sentences re-evaluated, -1 if slot is out of range.
+int editor_set(struct world_editor* ed, int slot, uint32_t o);
+
+// Effects: Appends o. Returns the number of sentences re-evaluated, -1 if full.
+int editor_add(struct world_editor* ed, uint32_t o);
+
+// Effects: Removes object slot; the last object takes its slot. Returns the number
+//   of sentences re-evaluated, -1 if slot is out of range.
+int editor_remove(struct world_editor* ed, int slot);
+
+#endif /* #ifndef __EDIT_H__ */
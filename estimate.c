@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include "tarski.h"
+#include "estimate.h"
+#include "rng.h"
+
+// Samples per batch; each batch has its own generator stream
+#define ESTIMATE_BATCH 16384
+// Batches between stopping-rule checks. Fixed so results do not depend on threads.
+#define ESTIMATE_ROUND 64
+// The interval is not trusted before this many accepted samples
+#define ESTIMATE_MIN_ACCEPTED 100
+
+// Up to 64 cells * 3 shapes * 3 sizes bodies
+#define MAX_BODIES 576
+#define BODY_WORDS ((MAX_BODIES + 63) / 64)
+
+// Running mean and sum of squared deviations (Welford), mergeable in a fixed order
+struct moments
+{
+	double n;
+	double mean;
+	double m2;
+	uint64_t accepted;
+};
+
+static inline void moments_add(struct moments* m, double x)
+{
+	m->n += 1;
+	double d = x - m->mean;
+	m->mean += d / m->n;
+	m->m2 += d * (x - m->mean);
+}
+
+static void moments_merge(struct moments* a, const struct moments* b)
+{
+	if(b->n == 0)
+		return;
+	double n = a->n + b->n;
+	double d = b->mean - a->mean;
+	a->mean += d * b->n / n;
+	a->m2 += b->m2 + d * d * a->n * b->n / n;
+	a->n = n;
+	a->accepted += b->accepted;
+}
+
+// Shared, read-only sampling state
+struct estimator
+{
+	const struct estimate_options* opt;
+	uint32_t* valid_objects;
+	int num_valid_objects;
+
+	// SIS: distinct bodies (object without labels) and which pairs can coexist
+	uint32_t bodies[MAX_BODIES];
+	int num_bodies;
+	int body_words;
+	uint64_t all_bodies[BODY_WORDS];
+	uint64_t body_compat[MAX_BODIES][BODY_WORDS];
+	double k_factorial;
+	double label_ways;      // (k+1)^6: each name on one of the k objects or on none
+
+	// Uniform: C(num_valid_objects, k)
+	double combinations;
+
+	// Current round
+	struct moments batch[ESTIMATE_ROUND];
+	uint64_t first_batch;
+	int next_batch;
+	pthread_mutex_t lock;
+};
+
+// Effects: Finds the bodies and their compatibility; false if valid_objects is not
+//   every body with every label mask
+static bool estimator_init_bodies(struct estimator* e)
+{
+	e->num_bodies = 0;
+	for(int i = 0; i < e->num_valid_objects; i++)
+	{
+		uint32_t body = e->valid_objects[i] & ~63u;
+		if(e->num_bodies && e->bodies[e->num_bodies - 1] == body)
+			continue;
+		if(e->num_bodies == MAX_BODIES)
+			return false;
+		e->bodies[e->num_bodies++] = body;
+	}
+	// valid_objects is sorted, so equal bodies are adjacent unless labels interleave
+	if(e->num_bodies * 64 != e->num_valid_objects)
+		return false;
+
+	e->body_words = (e->num_bodies + 63) / 64;
+	memset(e->all_bodies, 0, sizeof(e->all_bodies));
+	memset(e->body_compat, 0, sizeof(e->body_compat));
+	for(int a = 0; a < e->num_bodies; a++)
+	{
+		e->all_bodies[a / 64] |= 1ULL << (a % 64);
+		for(int b = 0; b < e->num_bodies; b++)
+		{
+			uint32_t pair[2] = { e->bodies[a], e->bodies[b] };
+			if(a != b && location_check_v2(2, pair))
+				e->body_compat[a][b / 64] |= 1ULL << (b % 64);
+		}
+	}
+	return true;
+}
+
+// Returns: product of the number of compatible bodies at each step, times the
+//   label assignments, over k!
+static double sample_sis(const struct estimator* e, struct rng* r, bool* accepted)
+{
+	uint64_t allowed[BODY_WORDS];
+	double weight = e->label_ways / e->k_factorial;
+
+	memcpy(allowed, e->all_bodies, sizeof(allowed));
+	for(int i = 0; i < e->opt->objects_in_world; i++)
+	{
+		int nb = 0;
+		for(int w = 0; w < e->body_words; w++)
+			nb += __builtin_popcountll(allowed[w]);
+		if(nb == 0)
+		{
+			*accepted = false;
+			return 0;
+		}
+		weight *= nb;
+
+		// The chosen body is the pick-th set bit of allowed
+		uint32_t pick = rng_below(r, nb);
+		int w = 0;
+		while(pick >= (uint32_t)__builtin_popcountll(allowed[w]))
+			pick -= __builtin_popcountll(allowed[w++]);
+		uint64_t bits = allowed[w];
+		while(pick--)
+			bits &= bits - 1;
+		int body = w * 64 + __builtin_ctzll(bits);
+
+		for(int j = 0; j < e->body_words; j++)
+			allowed[j] &= e->body_compat[body][j];
+	}
+	*accepted = true;
+	return weight;
+}
+
+// Returns: C(N, k) if a uniform k-combination is a valid world, else 0
+static double sample_uniform(const struct estimator* e, struct rng* r, bool* accepted)
+{
+	int k = e->opt->objects_in_world;
+	int chosen[MAX_OBJECTS_IN_WORLD];
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+
+	// Floyd's algorithm: k distinct indices out of N
+	int n = 0;
+	for(int j = e->num_valid_objects - k; j < e->num_valid_objects; j++)
+	{
+		int t = (int)rng_below(r, j + 1);
+		for(int i = 0; i < n; i++)
+			if(chosen[i] == t)
+			{
+				t = j;
+				break;
+			}
+		chosen[n++] = t;
+	}
+	for(int i = 0; i < k; i++)
+		w[i] = e->valid_objects[chosen[i]];
+
+	*accepted = check_world(w, k);
+	return *accepted ? e->combinations : 0;
+}
+
+static void* estimate_thread(void* arg)
+{
+	struct estimator* e = arg;
+	struct rng r;
+
+	while(true)
+	{
+		pthread_mutex_lock(&e->lock);
+		int b = e->next_batch++;
+		pthread_mutex_unlock(&e->lock);
+		if(b >= ESTIMATE_ROUND)
+			break;
+
+		struct moments m = { 0, 0, 0, 0 };
+		rng_seed(&r, e->opt->seed, e->first_batch + b);
+		for(int i = 0; i < ESTIMATE_BATCH; i++)
+		{
+			bool accepted;
+			double x = e->opt->method == ESTIMATE_SIS ? sample_sis(e, &r, &accepted) : sample_uniform(e, &r, &accepted);
+			moments_add(&m, x);
+			m.accepted += accepted;
+		}
+		e->batch[b] = m;
+	}
+	return NULL;
+}
+
+void estimate_options_default(struct estimate_options* opt, int objects_in_world)
+{
+	opt->objects_in_world = objects_in_world;
+	opt->method = ESTIMATE_SIS;
+	opt->rel_error = 0.001;
+	opt->z = 1.96;
+	opt->max_samples = 1ULL << 32;
+	opt->threads = 0;
+	opt->seed = 1;
+}
+
+bool estimate_worlds(uint32_t valid_objects[], int num_valid_objects, const struct estimate_options* opt,
+	struct estimate_result* result)
+{
+	int k = opt->objects_in_world;
+	int threads = opt->threads > 0 ? opt->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(threads <= 0)
+		threads = 1;
+
+	struct estimator* e = calloc(1, sizeof(*e));
+	pthread_t* tids = calloc(threads, sizeof(*tids));
+	if(!e || !tids)
+	{
+		perror("calloc");
+		free(e);
+		free(tids);
+		return false;
+	}
+	e->opt = opt;
+	e->valid_objects = valid_objects;
+	e->num_valid_objects = num_valid_objects;
+	pthread_mutex_init(&e->lock, NULL);
+
+	e->k_factorial = 1;
+	e->label_ways = pow(k + 1, 6);
+	e->combinations = 1;
+	for(int i = 1; i <= k; i++)
+	{
+		e->k_factorial *= i;
+		e->combinations = e->combinations * (num_valid_objects - k + i) / i;
+	}
+
+	bool ok = true;
+	if(opt->method == ESTIMATE_SIS && !estimator_init_bodies(e))
+	{
+		fprintf(stderr, "valid_objects is not bodies x label masks, use the uniform method\n");
+		ok = false;
+	}
+
+	struct moments total = { 0, 0, 0, 0 };
+	memset(result, 0, sizeof(*result));
+	while(ok && (uint64_t)total.n < opt->max_samples)
+	{
+		e->next_batch = 0;
+		for(int t = 0; t < threads && ok; t++)
+			ok = pthread_create(&tids[t], NULL, estimate_thread, e) == 0;
+		for(int t = 0; t < threads; t++)
+			pthread_join(tids[t], NULL);
+		if(!ok)
+		{
+			fprintf(stderr, "pthread_create failed\n");
+			break;
+		}
+		e->first_batch += ESTIMATE_ROUND;
+
+		// Merge in batch order so the floating point result is reproducible
+		for(int b = 0; b < ESTIMATE_ROUND; b++)
+			moments_merge(&total, &e->batch[b]);
+
+		double sd = total.n > 1 ? sqrt(total.m2 / (total.n - 1)) : 0;
+		result->count = total.mean;
+		result->half_width = opt->z * sd / sqrt(total.n);
+		result->samples = (uint64_t)total.n;
+		result->accepted = total.accepted;
+		if(total.accepted >= ESTIMATE_MIN_ACCEPTED && result->half_width <= opt->rel_error * result->count)
+		{
+			result->converged = true;
+			break;
+		}
+	}
+
+	pthread_mutex_destroy(&e->lock);
+	free(tids);
+	free(e);
+	return ok;
+}
+
+void print_estimate(const struct estimate_options* opt, const struct estimate_result* result)
+{
+	printf("Objects in world: %d \n", opt->objects_in_world);
+	printf("estimate = %.9e +- %.3e (z = %.2f, %s)\n", result->count, result->half_width, opt->z,
+		opt->method == ESTIMATE_SIS ? "sequential importance sampling" : "uniform combinations");
+	printf("samples = %" PRIu64 ", accepted = %" PRIu64 ", %s\n", result->samples, result->accepted,
+		result->converged ? "converged" : "stopped at max samples");
+}
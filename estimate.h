@@ -0,0 +1,62 @@
+#ifndef __ESTIMATE_H__
+#define __ESTIMATE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tarski.h"
+
+// Monte Carlo estimation of the number of valid worlds with k objects.
+//
+// ESTIMATE_UNIFORM draws uniform k-combinations of valid_objects and runs
+// check_world() on them; the estimate is C(NUM_VALID_OBJECTS, k) * acceptance.
+// This degrades quickly as the acceptance rate falls with k.
+//
+// ESTIMATE_SIS (sequential importance sampling) splits objects into bodies (cell,
+// size, shape) times the 64 label masks. Labels only interact through
+// letter_check(), so the (k+1)^6 disjoint label assignments are counted exactly
+// and only the bodies are sampled: one at a time, each uniform among the bodies
+// compatible with those already placed. The product of the number of choices,
+// times (k+1)^6, over k!, is an unbiased estimate of the count. Without large
+// objects every step has the same number of choices and the estimate is exact.
+//
+// Samples are drawn in fixed batches whose generator is seeded from (seed, batch
+// number) and combined in batch order, so a run is reproducible for a given
+// seed regardless of the number of threads.
+
+enum estimate_method
+{
+	ESTIMATE_SIS,
+	ESTIMATE_UNIFORM
+};
+
+struct estimate_options
+{
+	int objects_in_world;
+	enum estimate_method method;
+	double rel_error;       // stop when the CI half-width / estimate <= rel_error
+	double z;               // CI multiplier, 1.96 for 95%
+	uint64_t max_samples;   // stop here even if rel_error is not reached
+	int threads;            // 0 = number of online CPUs
+	uint64_t seed;
+};
+
+struct estimate_result
+{
+	double count;           // estimated number of valid worlds
+	double half_width;      // count +- half_width is the confidence interval
+	uint64_t samples;
+	uint64_t accepted;      // samples that produced a valid world
+	bool converged;         // rel_error reached before max_samples
+};
+
+void estimate_options_default(struct estimate_options* opt, int objects_in_world);
+
+// Requires: 0 <= opt->objects_in_world <= MAX_OBJECTS_IN_WORLD
+// Effects: Runs the estimator, returns false on allocation or thread failure
+bool estimate_worlds(uint32_t valid_objects[], int num_valid_objects, const struct estimate_options* opt,
+	struct estimate_result* result);
+
+// Effects: Prints the estimate and interval like the other modes
+void print_estimate(const struct estimate_options* opt, const struct estimate_result* result);
+
+#endif /* #ifndef __ESTIMATE_H__ */
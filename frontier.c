@@ -0,0 +1,417 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+#include "frontier.h"
+
+#define READ_CHUNK 4096      // states read from a file at a time
+#define MAX_RUNS 1024
+
+// What the objects of each cell look like to the frontier
+struct frontier_tables
+{
+	// num[c][large][labels] = objects on cell c with that largeness and labels
+	uint8_t num[NUM_CELLS][2][64];
+	bool any[NUM_CELLS][2];
+	// Cells where a non-large (clash_small) or large (clash_large) object clashes
+	// with an object on c of the given largeness
+	uint64_t clash_small[NUM_CELLS][2];
+	uint64_t clash_large[NUM_CELLS][2];
+	// Cells below next that objects on cells >= next can clash with
+	uint64_t live_small[NUM_CELLS + 1];
+	uint64_t live_large[NUM_CELLS + 1];
+};
+
+// Sorted states, in memory or in a temporary file
+struct frontier_list
+{
+	struct frontier_state* states;
+	FILE* file;
+	uint64_t num;
+};
+
+struct state_table
+{
+	struct frontier_state* slots;   // mult == 0 marks a free slot
+	size_t mask;
+	size_t used;
+};
+
+static void tables_build(struct frontier_tables* t, const uint32_t objects[], int num_objects)
+{
+	memset(t, 0, sizeof(*t));
+	for(int i = 0; i < num_objects; i++)
+	{
+		uint32_t o = objects[i];
+		int large = OBJECT_SIZE(o) & 1;
+		t->num[OBJECT_CELL(o)][large][OBJECT_LABELS(o)]++;
+		t->any[OBJECT_CELL(o)][large] = true;
+	}
+
+	// Medium and large dodecahedra stand for every non-large and large object
+	for(int c = 0; c < NUM_CELLS; c++)
+	{
+		for(int large = 0; large < 2; large++)
+		{
+			uint32_t o = (1 << (12 + 0)) | (1 << (15 + !large)) | (c << 6);
+			for(int e = 0; e < NUM_CELLS; e++)
+			{
+				if(objects_conflict(o, (1 << 12) | (1 << 16) | (e << 6)))
+					t->clash_small[c][large] |= 1ULL << e;
+				if(objects_conflict(o, (1 << 12) | (1 << 15) | (e << 6)))
+					t->clash_large[c][large] |= 1ULL << e;
+			}
+		}
+	}
+
+	uint64_t small = 0, large = 0;
+	for(int next = NUM_CELLS; next >= 0; next--)
+	{
+		uint64_t below = next == NUM_CELLS ? ALL_CELLS : (1ULL << next) - 1;
+		t->live_small[next] = small & below;
+		t->live_large[next] = large & below;
+		if(next > 0)
+		{
+			for(int l = 0; l < 2; l++)
+			{
+				if(!t->any[next - 1][l])
+					continue;
+				small |= t->clash_small[next - 1][l];
+				large |= t->clash_large[next - 1][l];
+			}
+		}
+	}
+}
+
+static int compare_states(const void* a, const void* b)
+{
+	const struct frontier_state* x = a;
+	const struct frontier_state* y = b;
+	if(x->next != y->next)
+		return x->next < y->next ? -1 : 1;
+	if(x->labels != y->labels)
+		return x->labels < y->labels ? -1 : 1;
+	if(x->occ != y->occ)
+		return x->occ < y->occ ? -1 : 1;
+	if(x->large != y->large)
+		return x->large < y->large ? -1 : 1;
+	return 0;
+}
+
+static inline bool same_state(const struct frontier_state* x, const struct frontier_state* y)
+{
+	return x->next == y->next && x->labels == y->labels && x->occ == y->occ && x->large == y->large;
+}
+
+static inline size_t state_hash(const struct frontier_state* s)
+{
+	uint64_t h = s->occ * 0x9e3779b97f4a7c15ULL;
+	h ^= s->large * 0xc2b2ae3d27d4eb4fULL;
+	h ^= ((uint64_t)s->next << 8 | s->labels) * 0x165667b19e3779f9ULL;
+	return (size_t)(h ^ (h >> 31));
+}
+
+// Effects: Adds s to the table, merging it with an equal state. Returns false if
+//   the table is more than half full afterwards.
+static bool table_add(struct state_table* t, const struct frontier_state* s)
+{
+	size_t h = state_hash(s) & t->mask;
+	while(t->slots[h].mult)
+	{
+		if(same_state(&t->slots[h], s))
+		{
+			t->slots[h].mult += s->mult;
+			return true;
+		}
+		h = (h + 1) & t->mask;
+	}
+	t->slots[h] = *s;
+	return ++t->used <= t->mask / 2;
+}
+
+// Effects: Moves the states of the table to its front, sorted, and empties the
+//   table. Returns their number.
+static size_t table_drain(struct state_table* t)
+{
+	size_t n = 0;
+	for(size_t i = 0; i <= t->mask; i++)
+		if(t->slots[i].mult)
+			t->slots[n++] = t->slots[i];
+	qsort(t->slots, n, sizeof(*t->slots), compare_states);
+	memset(t->slots + n, 0, (t->mask + 1 - n) * sizeof(*t->slots));
+	t->used = 0;
+	return n;
+}
+
+static void list_free(struct frontier_list* l)
+{
+	free(l->states);
+	if(l->file)
+		fclose(l->file);
+	memset(l, 0, sizeof(*l));
+}
+
+// Effects: Reads up to max states from l starting at *pos into buf. Returns the
+//   number read, 0 at the end.
+static size_t list_read(struct frontier_list* l, uint64_t* pos, struct frontier_state* buf, size_t max)
+{
+	size_t n = l->num - *pos < max ? (size_t)(l->num - *pos) : max;
+	if(l->file)
+		n = fread(buf, sizeof(*buf), n, l->file);
+	else
+		memcpy(buf, l->states + *pos, n * sizeof(*buf));
+	*pos += n;
+	return n;
+}
+
+// Effects: Merges the sorted runs into one sorted file of distinct states
+static bool merge_runs(FILE* runs[], uint64_t run_len[], int num_runs, struct frontier_list* out)
+{
+	struct frontier_state* heads = malloc(num_runs * sizeof(*heads));
+	uint64_t* left = malloc(num_runs * sizeof(*left));
+	FILE* f = tmpfile();
+	bool ok = heads && left && f;
+
+	for(int r = 0; ok && r < num_runs; r++)
+	{
+		rewind(runs[r]);
+		left[r] = run_len[r];
+		if(left[r] && fread(&heads[r], sizeof(*heads), 1, runs[r]) != 1)
+			ok = false;
+	}
+
+	out->num = 0;
+	while(ok)
+	{
+		// Few runs: a linear scan for the smallest head is enough
+		int min = -1;
+		for(int r = 0; r < num_runs; r++)
+			if(left[r] && (min < 0 || compare_states(&heads[r], &heads[min]) < 0))
+				min = r;
+		if(min < 0)
+			break;
+
+		struct frontier_state s = heads[min];
+		s.mult = 0;
+		for(int r = min; r < num_runs; r++)
+		{
+			while(left[r] && same_state(&heads[r], &s))
+			{
+				s.mult += heads[r].mult;
+				if(--left[r] && fread(&heads[r], sizeof(*heads), 1, runs[r]) != 1)
+					ok = false;
+			}
+		}
+		if(fwrite(&s, sizeof(s), 1, f) != 1)
+			ok = false;
+		out->num++;
+	}
+
+	free(heads);
+	free(left);
+	if(!ok)
+	{
+		if(f)
+			fclose(f);
+		return false;
+	}
+	rewind(f);
+	out->file = f;
+	return true;
+}
+
+// Returns: the number of worlds the states of a sorted array stand for
+static frontier_count_t sum_mult(const struct frontier_state* s, size_t n)
+{
+	frontier_count_t sum = 0;
+	for(size_t i = 0; i < n; i++)
+		sum += s[i].mult;
+	return sum;
+}
+
+// Effects: Writes the states of the table to a new sorted run, first merging the
+//   runs so far into one if there are MAX_RUNS of them
+static bool spill(struct state_table* table, FILE* runs[], uint64_t run_len[], int* num_runs)
+{
+	if(*num_runs == MAX_RUNS)
+	{
+		struct frontier_list merged = { 0 };
+		bool ok = merge_runs(runs, run_len, *num_runs, &merged);
+		for(int r = 0; r < *num_runs; r++)
+			fclose(runs[r]);
+		*num_runs = 0;
+		if(!ok)
+			return false;
+		runs[0] = merged.file;
+		run_len[0] = merged.num;
+		*num_runs = 1;
+	}
+
+	size_t len = table_drain(table);
+	FILE* f = tmpfile();
+	bool ok = f && fwrite(table->slots, sizeof(*table->slots), len, f) == len;
+	memset(table->slots, 0, len * sizeof(*table->slots));
+	if(!ok)
+	{
+		if(f)
+			fclose(f);
+		return false;
+	}
+	runs[*num_runs] = f;
+	run_len[(*num_runs)++] = len;
+	return true;
+}
+
+// Effects: Builds the frontier of the next level from cur into next
+static bool expand(const struct frontier_tables* t, struct frontier_list* cur, struct state_table* table,
+	struct frontier_list* next, struct frontier_stats* stats)
+{
+	struct frontier_state buf[READ_CHUNK];
+	FILE* runs[MAX_RUNS];
+	uint64_t run_len[MAX_RUNS];
+	int num_runs = 0;
+	uint64_t pos = 0;
+	bool ok = true;
+	size_t n;
+
+	memset(stats, 0, sizeof(*stats));
+	if(cur->file)
+		rewind(cur->file);
+
+	while(ok && (n = list_read(cur, &pos, buf, READ_CHUNK)))
+	{
+		for(size_t i = 0; ok && i < n; i++)
+		{
+			const struct frontier_state* s = &buf[i];
+			uint8_t free_labels = ALL_LABELS & ~s->labels;
+			for(int c = s->next; ok && c < NUM_CELLS; c++)
+			{
+				for(int large = 0; ok && large < 2; large++)
+				{
+					if(!t->any[c][large] || (s->occ & t->clash_small[c][large]) || (s->large & t->clash_large[c][large]))
+						continue;
+
+					struct frontier_state child;
+					child.next = c + 1;
+					child.occ = (s->occ | (large ? 0 : 1ULL << c)) & t->live_small[c + 1];
+					child.large = (s->large | (large ? 1ULL << c : 0)) & t->live_large[c + 1];
+
+					// Every label mask disjoint from the names in use, 0 included
+					uint8_t l = free_labels;
+					do
+					{
+						if(t->num[c][large][l])
+						{
+							child.labels = s->labels | l;
+							child.mult = s->mult * t->num[c][large][l];
+							stats->children++;
+							// Table full: spill it as a sorted run
+							if(!table_add(table, &child))
+							{
+								stats->runs++;
+								if(!spill(table, runs, run_len, &num_runs))
+								{
+									ok = false;
+									break;
+								}
+							}
+						}
+						l = (l - 1) & free_labels;
+					} while(l != free_labels);
+				}
+			}
+		}
+	}
+	if(cur->file && ferror(cur->file))
+		ok = false;
+
+	if(ok && num_runs == 0)
+	{
+		// Everything fit: the table is the next frontier
+		size_t len = table_drain(table);
+		next->states = malloc(len * sizeof(*next->states) + 1);
+		if(!next->states)
+			ok = false;
+		else
+		{
+			memcpy(next->states, table->slots, len * sizeof(*next->states));
+			next->num = len;
+		}
+		memset(table->slots, 0, len * sizeof(*table->slots));
+	}
+	else if(ok)
+	{
+		stats->runs++;
+		ok = spill(table, runs, run_len, &num_runs) && merge_runs(runs, run_len, num_runs, next);
+	}
+	else
+		memset(table->slots, 0, (table->mask + 1) * sizeof(*table->slots));
+
+	for(int r = 0; r < num_runs; r++)
+		fclose(runs[r]);
+	stats->states = next->num;
+	return ok;
+}
+
+bool frontier_count(const uint32_t objects[], int num_objects, const struct frontier_options* opt,
+	struct bn counts[], struct frontier_stats stats[])
+{
+	struct frontier_tables* t = malloc(sizeof(*t));
+	struct state_table table = { 0 };
+	struct frontier_list cur = { 0 }, next = { 0 };
+	bool ok = t != NULL;
+
+	// Largest power of two of slots that fits, at least 256
+	size_t slots = 256;
+	while(slots * 2 * sizeof(struct frontier_state) <= opt->memory)
+		slots *= 2;
+	table.slots = calloc(slots, sizeof(*table.slots));
+	table.mask = slots - 1;
+	ok = ok && table.slots;
+
+	for(int k = 0; k <= opt->max_objects; k++)
+		bignum_init(&counts[k]);
+
+	if(ok)
+	{
+		tables_build(t, objects, num_objects);
+
+		// Level 0: the empty world
+		cur.states = calloc(1, sizeof(*cur.states));
+		ok = cur.states != NULL;
+		if(ok)
+		{
+			cur.states[0].mult = 1;
+			cur.num = 1;
+			memset(&stats[0], 0, sizeof(stats[0]));
+			stats[0].states = stats[0].children = 1;
+			bignum_from_int(&counts[0], 1);
+		}
+	}
+
+	for(int k = 1; ok && k <= opt->max_objects; k++)
+	{
+		ok = expand(t, &cur, &table, &next, &stats[k]);
+		list_free(&cur);
+		cur = next;
+		memset(&next, 0, sizeof(next));
+
+		// Total the new level
+		struct frontier_state buf[READ_CHUNK];
+		frontier_count_t total = 0;
+		uint64_t pos = 0;
+		size_t n;
+		while(ok && (n = list_read(&cur, &pos, buf, READ_CHUNK)))
+			total += sum_mult(buf, n);
+		if(ok && pos != cur.num)
+			ok = false;
+		bignum_from_u128(total, &counts[k]);
+	}
+
+	list_free(&cur);
+	free(table.slots);
+	free(t);
+	return ok;
+}
@@ -0,0 +1,62 @@
+#ifndef __FRONTIER_H__
+#define __FRONTIER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "bn.h"
+#include "tarski.h"
+
+// Level-synchronous counting: the valid k-worlds are built from the valid
+// (k-1)-worlds instead of from scratch.
+//
+// Worlds are taken with their objects in increasing cell order (check_world rejects
+// two objects on one cell, so that order is unique). A world is then extended only
+// by objects on higher cells, and all it has to remember is
+//   - next:   the lowest cell a further object may use
+//   - labels: the names used so far
+//   - occ, large: the cells below next holding non-large and large objects, kept
+//     only where an object on a cell >= next could clash with them
+// Worlds with equal states have the same extensions, so each level is a frontier
+// of distinct states with multiplicities (the number of worlds merged into each),
+// and objects of one cell with equal labels and equal largeness are added in one
+// step, weighted by how many of them there are. Without large objects occ and
+// large are always empty and a level has at most 65 * 64 states.
+//
+// Children of one level are merged in a hash table of at most memory bytes. When
+// it fills, its states are sorted and written to a temporary file as a run; the
+// runs of a level are then merged into the next frontier, which is read back from
+// disk. Multiplicities are exact 128-bit integers: no level has 2^102 worlds.
+
+typedef unsigned __int128 frontier_count_t;
+
+struct frontier_state
+{
+	uint64_t occ;
+	uint64_t large;
+	frontier_count_t mult;
+	uint8_t next;
+	uint8_t labels;
+};
+
+struct frontier_options
+{
+	int max_objects;
+	size_t memory;          // bytes for the table of children, at least a few KiB
+};
+
+struct frontier_stats
+{
+	uint64_t states;        // distinct states at this level
+	uint64_t children;      // states generated before merging
+	int runs;               // sorted runs spilled to disk
+};
+
+// Requires: objects is an increasing subset of valid_objects, counts and stats hold
+//   max_objects + 1 entries
+// Effects: counts[k] = number of valid worlds of k objects from objects, stats[k]
+//   describes level k. Returns false on allocation or I/O failure.
+bool frontier_count(const uint32_t objects[], int num_objects, const struct frontier_options* opt,
+	struct bn counts[], struct frontier_stats stats[]);
+
+#endif /* #ifndef __FRONTIER_H__ */
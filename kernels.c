@@ -0,0 +1,101 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "tarski.h"
+#include "count.h"
+#include "kernels.h"
+
+#define KERNEL static inline __attribute__((always_inline))
+
+KERNEL bool check_fixed(const uint32_t w[], const int k)
+{
+	uint64_t centers = 0, edges = 0;
+	uint32_t labels = 0;
+
+#pragma GCC unroll 12
+	for(int i = 0; i < k; i++)
+		if(!board_place(w[i], &centers, &edges, &labels))
+			return false;
+	return true;
+}
+
+KERNEL uint64_t enumerate_fixed(uint32_t objects[], int num_objects, int first_lead, int last_lead,
+	world_visitor visit, void* ctx, const int k)
+{
+	int indices[MAX_OBJECTS_IN_WORLD];
+	uint32_t world[MAX_OBJECTS_IN_WORLD];
+	uint64_t accepted = 0;
+	int y;
+
+#pragma GCC unroll 12
+	for(int i = 0; i < k; i++)
+	{
+		indices[i] = first_lead + i;
+		world[i] = objects[indices[i]];
+	}
+
+	while(true)
+	{
+		if(check_fixed(world, k))
+		{
+			accepted++;
+			if(visit) visit(world, indices, k, ctx);
+		}
+
+		// Rightmost index that can still move
+		for(y = k - 1; y >= 0 && indices[y] == y + num_objects - k; y--)
+			;
+		if(y < 0)
+			break;
+		indices[y]++;
+		if(indices[0] >= last_lead)
+			break;
+		world[y] = objects[indices[y]];
+		for(int z = y + 1; z < k; z++)
+		{
+			indices[z] = indices[z - 1] + 1;
+			world[z] = objects[indices[z]];
+		}
+	}
+	return accepted;
+}
+
+#define DEFINE_KERNELS(K)                                                                        \
+	static bool check_world_##K(const uint32_t w[])                                              \
+	{                                                                                            \
+		return check_fixed(w, K);                                                                \
+	}                                                                                            \
+	static uint64_t enumerate_##K(uint32_t objects[], int num_objects, int first_lead, int last_lead, \
+		world_visitor visit, void* ctx)                                                          \
+	{                                                                                            \
+		return enumerate_fixed(objects, num_objects, first_lead, last_lead, visit, ctx, K);      \
+	}
+
+DEFINE_KERNELS(1)
+DEFINE_KERNELS(2)
+DEFINE_KERNELS(3)
+DEFINE_KERNELS(4)
+DEFINE_KERNELS(5)
+DEFINE_KERNELS(6)
+DEFINE_KERNELS(7)
+DEFINE_KERNELS(8)
+DEFINE_KERNELS(9)
+DEFINE_KERNELS(10)
+DEFINE_KERNELS(11)
+DEFINE_KERNELS(12)
+
+#if MAX_OBJECTS_IN_WORLD != 12
+#error "kernels.c instantiates k = 1..12; update the kernel lists for MAX_OBJECTS_IN_WORLD"
+#endif
+
+const check_kernel check_kernels[MAX_OBJECTS_IN_WORLD + 1] =
+{
+	NULL, check_world_1, check_world_2, check_world_3, check_world_4, check_world_5, check_world_6,
+	check_world_7, check_world_8, check_world_9, check_world_10, check_world_11, check_world_12
+};
+
+const enumerate_kernel enumerate_kernels[MAX_OBJECTS_IN_WORLD + 1] =
+{
+	NULL, enumerate_1, enumerate_2, enumerate_3, enumerate_4, enumerate_5, enumerate_6,
+	enumerate_7, enumerate_8, enumerate_9, enumerate_10, enumerate_11, enumerate_12
+};
@@ -0,0 +1,68 @@
+#ifndef __KERNELS_H__
+#define __KERNELS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tarski.h"
+#include "count.h"
+
+// Validation and enumeration specialized for each world size k.
+//
+// kernels.c instantiates one check and one enumeration loop per k = 1 ..
+// MAX_OBJECTS_IN_WORLD from a single always-inlined body with k a compile-time
+// constant, so every loop over the objects of a world is unrolled, and the world
+// state lives in registers instead of location_check_v2's row array: one 64-bit
+// board of object centers, one of the edges of large objects, and the names used.
+// Callers index the tables by k once per level.
+//
+// A check kernel accepts exactly the worlds check_world accepts.
+
+// Cells with y == 0 and y == 7 (cell = x * 8 + y)
+#define ROW_Y0 0x0101010101010101ULL
+#define ROW_Y7 0x8080808080808080ULL
+
+// Returns: the cells around the cells of board b, without those of b
+static inline uint64_t board_neighbours(uint64_t b)
+{
+	uint64_t column = b | ((b << 1) & ~ROW_Y0) | ((b >> 1) & ~ROW_Y7);
+	return (column | (column << 8) | (column >> 8)) & ~b;
+}
+
+// Effects: Places object o on the boards. Returns false if it clashes with the
+//   objects placed before it, as letter_check and location_check_v2 would find.
+static inline __attribute__((always_inline)) bool board_place(uint32_t o, uint64_t* centers, uint64_t* edges,
+	uint32_t* labels)
+{
+	uint64_t b = 1ULL << OBJECT_CELL(o);
+
+	// A center may not land on another center or on a large object's edge
+	if((*labels & o & ALL_LABELS) || ((*centers | *edges) & b))
+		return false;
+	*labels |= o & ALL_LABELS;
+	*centers |= b;
+	// A large object's edges may not cover a center
+	if(o & (1 << 15))
+	{
+		uint64_t around = board_neighbours(b);
+		if(around & *centers)
+			return false;
+		*edges |= around;
+	}
+	return true;
+}
+
+// Returns: check_world(w, k) for the kernel's k
+typedef bool (*check_kernel)(const uint32_t w[]);
+
+// Requires: 0 <= first_lead < last_lead <= num_objects - k + 1
+// Effects: Calls visit (if non-null) for every valid world of k objects whose lead
+//   index lies in [first_lead, last_lead), in the order enumerate_objects uses.
+//   Returns the number of them.
+typedef uint64_t (*enumerate_kernel)(uint32_t objects[], int num_objects, int first_lead, int last_lead,
+	world_visitor visit, void* ctx);
+
+// Entries 1..MAX_OBJECTS_IN_WORLD; entry 0 is null
+extern const check_kernel check_kernels[MAX_OBJECTS_IN_WORLD + 1];
+extern const enumerate_kernel enumerate_kernels[MAX_OBJECTS_IN_WORLD + 1];
+
+#endif /* #ifndef __KERNELS_H__ */
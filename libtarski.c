@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "bn.h"
+#include "tarski.h"
+#include "kernels.h"
+#include "libtarski.h"
+
+static uint32_t valid_objects[NUM_VALID_OBJECTS];
+
+static void build_valid_objects(void)
+{
+	if(generate_valid_objects(valid_objects) != NUM_VALID_OBJECTS)
+	{
+		fprintf(stderr, "generate_valid_objects: unexpected object count\n");
+		exit(1);
+	}
+}
+
+const uint32_t* tarski_valid_objects(void)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	pthread_once(&once, build_valid_objects);
+	return valid_objects;
+}
+
+void tarski_count_level(int objects_in_world, struct bn* count)
+{
+	bignum_init(count);
+	count_level_by_cell(objects_in_world, 0, NUM_VALID_OBJECTS, count);
+}
+
+void tarski_iter_init(struct tarski_iter* it, const uint32_t objects[], int num_objects, int objects_in_world,
+	int first_lead, int last_lead)
+{
+	it->objects = objects;
+	it->num_objects = num_objects;
+	it->k = objects_in_world;
+
+	// The empty world has no lead object; it belongs to the range starting at 0
+	if(objects_in_world == 0)
+	{
+		it->last_lead = 0;
+		it->depth = first_lead <= 0 && last_lead > 0 ? 0 : -1;
+		return;
+	}
+
+	// No combination can start past the last possible lead
+	if(last_lead > num_objects - objects_in_world + 1)
+		last_lead = num_objects - objects_in_world + 1;
+	if(first_lead < 0)
+		first_lead = 0;
+	it->last_lead = last_lead;
+	it->depth = first_lead < last_lead ? 0 : -1;
+	it->indices[0] = first_lead;
+	it->centers[0] = 0;
+	it->edges[0] = 0;
+	it->labels[0] = 0;
+}
+
+// Effects: Advances it to the next valid world, left in it->world. Returns false
+//   once there is none.
+static bool iter_step(struct tarski_iter* it)
+{
+	const int k = it->k;
+
+	if(k == 0)
+	{
+		if(it->depth < 0)
+			return false;
+		it->depth = -1;
+		return true;
+	}
+
+	while(it->depth >= 0)
+	{
+		int d = it->depth;
+		int i = it->indices[d];
+		int end = d == 0 ? it->last_lead : it->num_objects - k + d + 1;
+
+		// Out of candidates at this depth: back up to the object before it
+		if(i >= end)
+		{
+			it->depth--;
+			continue;
+		}
+
+		uint64_t centers = it->centers[d], edges = it->edges[d];
+		uint32_t labels = it->labels[d];
+		it->indices[d] = i + 1;
+		if(!board_place(it->objects[i], &centers, &edges, &labels))
+			continue;
+		it->world[d] = it->objects[i];
+		if(d == k - 1)
+			return true;
+
+		it->centers[d + 1] = centers;
+		it->edges[d + 1] = edges;
+		it->labels[d + 1] = labels;
+		it->indices[d + 1] = i + 1;
+		it->depth = d + 1;
+	}
+	return false;
+}
+
+int tarski_iter_next(struct tarski_iter* it, uint32_t out[], int max_worlds)
+{
+	int n = 0;
+
+	while(n < max_worlds && iter_step(it))
+	{
+		for(int i = 0; i < it->k; i++)
+			out[n * it->k + i] = it->world[i];
+		n++;
+	}
+	return n;
+}
+
+uint64_t tarski_for_each_block(const uint32_t objects[], int num_objects, int objects_in_world,
+	int first_lead, int last_lead, tarski_block_fn fn, void* ctx)
+{
+	struct tarski_iter it;
+	uint32_t block[TARSKI_BLOCK_WORLDS * MAX_OBJECTS_IN_WORLD];
+	uint64_t total = 0;
+	int n;
+
+	tarski_iter_init(&it, objects, num_objects, objects_in_world, first_lead, last_lead);
+	while((n = tarski_iter_next(&it, block, TARSKI_BLOCK_WORLDS)) > 0)
+	{
+		fn(block, n, objects_in_world, ctx);
+		total += n;
+	}
+	return total;
+}
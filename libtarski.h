@@ -0,0 +1,93 @@
+#ifndef __LIBTARSKI_H__
+#define __LIBTARSKI_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+#include "kernels.h"
+#include "cellorder.h"
+#include "frontier.h"
+#include "zdd.h"
+#include "rank.h"
+#include "canon.h"
+#include "dist.h"
+#include "orbit.h"
+
+// libtarski: the enumerator as a library, for programs that consume worlds in
+// process instead of parsing the tarski binary's output.
+//
+// This header pulls in the engines themselves: check_world and the per-size
+// kernels (tarski.h, kernels.h), the closed-form counts and their breakdowns by
+// shape, size and names (count.h, dist.h), the cell-order counter behind
+// count_level_by_cell (cellorder.h), the frontier and ZDD counters, dense world
+// IDs, canonical fingerprints (canon.h) and the enumeration of name orbits
+// (orbit.h). Lead ranges of the iterator below index objects, as those of
+// count_level and enumerate_level index valid_objects; the leads of
+// count_level_by_cell are not interchangeable with them.
+// On top of them it adds a shared valid-object table and two ways to stream the
+// valid worlds of one level:
+//   pull  tarski_iter_next fills a caller buffer with the next worlds
+//   push  tarski_for_each_block hands blocks of worlds to a callback
+// Neither allocates: the iterator is a plain struct the caller owns, and the
+// push loop keeps its block on the stack. Both walk the objects depth-first and
+// drop a prefix as soon as its last object clashes, yielding the worlds in the
+// order enumerate_objects visits them.
+//
+// Built as build/libtarski.a and build/libtarski.so by `make lib`; link with
+// -pthread -lm.
+
+// Worlds per block of tarski_for_each_block
+#define TARSKI_BLOCK_WORLDS 256
+
+// Returns: valid_objects as generate_valid_objects fills it (NUM_VALID_OBJECTS
+//   entries, increasing), built on first use and shared by all threads
+const uint32_t* tarski_valid_objects(void);
+
+// Effects: *count = number of valid worlds of objects_in_world objects, from
+//   count_level_by_cell
+void tarski_count_level(int objects_in_world, struct bn* count);
+
+struct tarski_iter
+{
+	const uint32_t* objects;
+	int num_objects;
+	int k;                                        // objects per world
+	int last_lead;
+	int depth;                                    // object being chosen, -1 once done
+	int indices[MAX_OBJECTS_IN_WORLD];            // next candidate at each depth
+	uint32_t world[MAX_OBJECTS_IN_WORLD];
+	// Boards before the object at each depth is placed
+	uint64_t centers[MAX_OBJECTS_IN_WORLD];
+	uint64_t edges[MAX_OBJECTS_IN_WORLD];
+	uint32_t labels[MAX_OBJECTS_IN_WORLD];
+};
+
+// Requires: objects increasing, without duplicates, and outlives it;
+//   0 <= objects_in_world <= MAX_OBJECTS_IN_WORLD
+// Modifies: *it
+// Effects: Starts an iteration over the valid worlds of objects_in_world objects
+//   whose lead index lies in [first_lead, last_lead), as enumerate_objects counts
+//   them. The empty world belongs to the lead range containing 0.
+void tarski_iter_init(struct tarski_iter* it, const uint32_t objects[], int num_objects, int objects_in_world,
+	int first_lead, int last_lead);
+
+// Requires: out has room for max_worlds * it->k entries
+// Modifies: *it, out
+// Effects: Writes up to max_worlds further worlds to out, world i at
+//   out[i * it->k], objects in increasing order. Returns the number written, 0
+//   once the iteration is over (the empty world takes no room in out).
+int tarski_iter_next(struct tarski_iter* it, uint32_t out[], int max_worlds);
+
+// Called with each block of worlds, laid out as by tarski_iter_next; the block is
+// only valid for the duration of the call.
+typedef void (*tarski_block_fn)(const uint32_t worlds[], int num_worlds, int sizeof_w, void* ctx);
+
+// Requires: as tarski_iter_init
+// Effects: Calls fn with every valid world of the lead range, up to
+//   TARSKI_BLOCK_WORLDS at a time. Returns the number of worlds.
+uint64_t tarski_for_each_block(const uint32_t objects[], int num_objects, int objects_in_world,
+	int first_lead, int last_lead, tarski_block_fn fn, void* ctx);
+
+#endif /* #ifndef __LIBTARSKI_H__ */
@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+#include "sentence.h"
+#include "worldfile.h"
+#include "batch.h"
+#include "spatial.h"
+#include "models.h"
+
+#define ALL_ATTRS 0x1FF
+
+// Returns: the attrs index (size index * 3 + shape index) of object o
+static inline int object_attr(uint32_t o)
+{
+	return __builtin_ctz(OBJECT_SIZE(o)) * NUM_SHAPES + __builtin_ctz(OBJECT_SHAPE(o));
+}
+
+static bool is_spatial(int pred)
+{
+	return (pred >= PRED_LEFTOF && pred <= PRED_SAMECOL) || pred == PRED_ADJOINS;
+}
+
+// Effects: *term = the only term used under node n, if n is a boolean combination
+//   of unary atoms on that one term. Returns false otherwise.
+static bool unary_only(const struct sentence* s, int n, int* term)
+{
+	const struct sentence_node* node = &s->nodes[n];
+	switch(node->op)
+	{
+		case OP_ATOM:
+			if(node->pred > PRED_LARGE)
+				return false;
+			if(*term >= 0 && *term != node->arg[0])
+				return false;
+			*term = node->arg[0];
+			return true;
+		case OP_NOT:
+			return unary_only(s, node->left, term);
+		case OP_AND:
+		case OP_OR:
+		case OP_IMPLIES:
+		case OP_IFF:
+			return unary_only(s, node->left, term) && unary_only(s, node->right, term);
+	}
+	return false;
+}
+
+// Returns: mask of attrs for which the sub-sentence rooted at n holds on a lone
+//   object carrying every name
+static uint16_t attrs_satisfying(const struct sentence* s, int n)
+{
+	struct sentence sub = *s;
+	struct eval_world ew;
+	uint16_t mask = 0;
+
+	sub.root = n;
+	for(int size = 0; size < NUM_SIZES; size++)
+	{
+		for(int shape = 0; shape < NUM_SHAPES; shape++)
+		{
+			uint32_t o = (1u << (15 + size)) | (1u << (12 + shape)) | ALL_LABELS;
+			eval_world_load(&ew, &o, 1);
+			if(sentence_eval(&sub, &ew) == SENTENCE_TRUE)
+				mask |= 1 << (size * NUM_SHAPES + shape);
+		}
+	}
+	return mask;
+}
+
+// Returns: cells c such that R(c, c') holds for some c' (first = true), or such
+//   that R(c', c) holds for some c' (first = false)
+static uint64_t relation_support(int pred, bool first)
+{
+	uint64_t mask = 0;
+	for(int c = 0; c < NUM_CELLS; c++)
+		if(spatial_cells(pred, first ? 1 : 0, c, 0))
+			mask |= 1ULL << c;
+	return mask;
+}
+
+static void derive_conjunct(const struct sentence* s, int n, struct object_constraints* oc)
+{
+	const struct sentence_node* node = &s->nodes[n];
+	int term = -1;
+
+	if(node->op == OP_AND)
+	{
+		derive_conjunct(s, node->left, oc);
+		derive_conjunct(s, node->right, oc);
+		return;
+	}
+
+	// Unary condition on one name
+	if(unary_only(s, n, &term) && term < TERM_VAR)
+	{
+		oc->name_attrs[term] &= attrs_satisfying(s, n);
+		return;
+	}
+
+	// Unary condition on every object
+	term = -1;
+	if(node->op == OP_FORALL && unary_only(s, node->left, &term) && term == TERM_VAR + node->var)
+	{
+		oc->all_attrs &= attrs_satisfying(s, n);
+		return;
+	}
+
+	// Names equal or distinct
+	const struct sentence_node* atom = node->op == OP_NOT ? &s->nodes[node->left] : node;
+	if(atom->op == OP_ATOM && atom->pred == PRED_EQUAL && atom->arg[0] < TERM_VAR && atom->arg[1] < TERM_VAR
+		&& atom->arg[0] != atom->arg[1])
+	{
+		int a = atom->arg[0], b = atom->arg[1];
+		if(node->op == OP_NOT)
+		{
+			oc->name_without[a] |= 1 << b;
+			oc->name_without[b] |= 1 << a;
+		}
+		else
+		{
+			oc->name_with[a] |= 1 << b;
+			oc->name_with[b] |= 1 << a;
+		}
+		return;
+	}
+
+	// Spatial relation between two names
+	if(node->op == OP_ATOM && is_spatial(node->pred))
+	{
+		if(node->arg[0] < TERM_VAR)
+			oc->name_cells[node->arg[0]] &= relation_support(node->pred, true);
+		if(node->arg[1] < TERM_VAR)
+			oc->name_cells[node->arg[1]] &= relation_support(node->pred, false);
+		return;
+	}
+
+	// Something stands in a spatial relation to a name
+	if(node->op != OP_EXISTS)
+		return;
+	atom = &s->nodes[node->left];
+	if(atom->op == OP_ATOM && is_spatial(atom->pred))
+	{
+		int var = TERM_VAR + node->var;
+		if(atom->arg[0] == var && atom->arg[1] < TERM_VAR)
+			oc->name_cells[atom->arg[1]] &= relation_support(atom->pred, false);
+		else if(atom->arg[1] == var && atom->arg[0] < TERM_VAR)
+			oc->name_cells[atom->arg[0]] &= relation_support(atom->pred, true);
+	}
+}
+
+void derive_object_constraints(const struct sentence* s, struct object_constraints* oc)
+{
+	oc->all_attrs = ALL_ATTRS;
+	for(int n = 0; n < NUM_LABELS; n++)
+	{
+		oc->name_attrs[n] = ALL_ATTRS;
+		oc->name_cells[n] = ALL_CELLS;
+		oc->name_with[n] = 0;
+		oc->name_without[n] = 0;
+	}
+	derive_conjunct(s, s->root, oc);
+}
+
+bool object_allowed(const struct object_constraints* oc, uint32_t o)
+{
+	int attr = object_attr(o);
+	int cell = OBJECT_CELL(o);
+	uint8_t labels = OBJECT_LABELS(o);
+
+	if(!((oc->all_attrs >> attr) & 1))
+		return false;
+	for(uint8_t l = labels; l; l &= l - 1)
+	{
+		int n = __builtin_ctz(l);
+		if(!((oc->name_attrs[n] >> attr) & 1) || !((oc->name_cells[n] >> cell) & 1))
+			return false;
+		if((oc->name_with[n] & ~labels) || (oc->name_without[n] & labels))
+			return false;
+	}
+	return true;
+}
+
+// State shared by the threads of one level
+struct model_level
+{
+	const struct sentence* s;
+	uint32_t* objects;
+	int num_objects;
+	int objects_in_world;
+	int next_lead;
+	struct world_writer* wr;
+	pthread_mutex_t lock;
+};
+
+struct model_thread
+{
+	struct model_level* level;
+	struct bn models;
+	bool batched;                // evaluate blocks of worlds with prog
+	struct batch_program prog;
+	struct world_block block;
+	pthread_t tid;
+};
+
+// Effects: Evaluates and empties the thread's block of worlds
+static void flush_block(struct model_thread* t)
+{
+	uint64_t truth, undefined;
+	struct bn n;
+
+	if(t->block.num_worlds == 0)
+		return;
+	batch_eval(&t->prog, &t->block, &truth, &undefined);
+	bignum_from_int(&n, __builtin_popcountll(truth));
+	bignum_add(&t->models, &n, &t->models);
+	if(t->level->wr && truth)
+	{
+		pthread_mutex_lock(&t->level->lock);
+		for(; truth; truth &= truth - 1)
+			world_writer_add(t->level->wr, t->block.worlds[__builtin_ctzll(truth)], NULL);
+		pthread_mutex_unlock(&t->level->lock);
+	}
+	world_block_reset(&t->block, t->level->objects_in_world);
+}
+
+static void visit_model(uint32_t w[], const int indices[], int sizeof_w, void* ctx)
+{
+	struct model_thread* t = ctx;
+	struct eval_world ew;
+
+	if(t->batched)
+	{
+		if(world_block_add(&t->block, w))
+			flush_block(t);
+		return;
+	}
+	eval_world_load(&ew, w, sizeof_w);
+	if(sentence_eval(t->level->s, &ew) != SENTENCE_TRUE)
+		return;
+	bignum_inc(&t->models);
+	if(t->level->wr)
+	{
+		pthread_mutex_lock(&t->level->lock);
+		world_writer_add(t->level->wr, w, NULL);
+		pthread_mutex_unlock(&t->level->lock);
+	}
+}
+
+static void* model_thread_main(void* arg)
+{
+	struct model_thread* t = arg;
+	struct model_level* level = t->level;
+	int leads = level->objects_in_world == 0 ? 1 : level->num_objects - level->objects_in_world + 1;
+	struct bn valid;
+
+	bignum_init(&valid);
+	t->batched = batch_compile(level->s, level->objects_in_world, &t->prog);
+	world_block_reset(&t->block, level->objects_in_world);
+	// Leads are handed out one at a time; low leads carry most of the work
+	while(true)
+	{
+		int lead = __atomic_fetch_add(&level->next_lead, 1, __ATOMIC_RELAXED);
+		if(lead >= leads)
+			break;
+		enumerate_objects(level->objects, level->num_objects, level->objects_in_world, lead, lead + 1,
+			&valid, visit_model, t);
+	}
+	if(t->batched)
+	{
+		flush_block(t);
+		batch_program_free(&t->prog);
+	}
+	return NULL;
+}
+
+bool count_models(uint32_t valid_objects[], int num_valid_objects, const struct sentence* s,
+	const struct model_options* opt, struct bn counts[MAX_OBJECTS_IN_WORLD + 1])
+{
+	struct object_constraints oc;
+	int threads = opt->threads > 0 ? opt->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(threads <= 0)
+		threads = 1;
+
+	for(int k = 0; k <= MAX_OBJECTS_IN_WORLD; k++)
+		bignum_init(&counts[k]);
+
+	uint32_t* objects = malloc(num_valid_objects * sizeof(*objects));
+	struct model_thread* pool = calloc(threads, sizeof(*pool));
+	if(!objects || !pool)
+	{
+		perror("malloc");
+		free(objects);
+		free(pool);
+		return false;
+	}
+
+	derive_object_constraints(s, &oc);
+	int num_objects = 0;
+	for(int i = 0; i < num_valid_objects; i++)
+		if(object_allowed(&oc, valid_objects[i]))
+			objects[num_objects++] = valid_objects[i];
+	fprintf(stderr, "Objects after constraint pushdown: %d of %d\n", num_objects, num_valid_objects);
+
+	bool ok = true;
+	for(int k = opt->min_objects; k <= opt->max_objects && ok; k++)
+	{
+		struct model_level level = { s, objects, num_objects, k, 0, NULL, PTHREAD_MUTEX_INITIALIZER };
+		struct world_writer wr;
+
+		if(opt->path)
+		{
+			char path[4096];
+			if(opt->min_objects == opt->max_objects)
+				snprintf(path, sizeof(path), "%s", opt->path);
+			else
+				snprintf(path, sizeof(path), "%s.%d", opt->path, k);
+			if(!world_writer_open(&wr, path, k, WORLD_ENCODING_PACKED18))
+			{
+				ok = false;
+				break;
+			}
+			level.wr = &wr;
+		}
+
+		int started = 0;
+		for(int t = 0; t < threads; t++)
+		{
+			pool[t].level = &level;
+			bignum_init(&pool[t].models);
+			if(pthread_create(&pool[t].tid, NULL, model_thread_main, &pool[t]) != 0)
+			{
+				fprintf(stderr, "pthread_create failed\n");
+				ok = false;
+				break;
+			}
+			started++;
+		}
+		for(int t = 0; t < started; t++)
+		{
+			pthread_join(pool[t].tid, NULL);
+			bignum_add(&counts[k], &pool[t].models, &counts[k]);
+		}
+
+		if(level.wr && !world_writer_close(&wr))
+			ok = false;
+		pthread_mutex_destroy(&level.lock);
+	}
+
+	free(pool);
+	free(objects);
+	return ok;
+}
@@ -0,0 +1,56 @@
+#ifndef __MODELS_H__
+#define __MODELS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bn.h"
+#include "tarski.h"
+#include "sentence.h"
+
+// Model counting: the number of valid worlds in which a sentence is true.
+//
+// Before enumerating, the top-level conjuncts of the sentence are turned into
+// constraints on single objects, and valid_objects is filtered down to the
+// objects that can appear in a model at all:
+//   - a formula over one name and unary predicates (Cube(a), ~(Small(a) | Tet(a)))
+//     fixes the (size, shape) pairs an object carrying that name may have
+//   - forall x over unary predicates of x does the same for every object
+//   - a spatial atom between names, or exists x R(x, a) / R(a, x), limits the
+//     cells an object carrying the name may stand on (e.g. exists x LeftOf(x, b)
+//     keeps b out of the leftmost column)
+//   - a = b and ~a = b force the two names onto the same or different objects
+// Combinations are then only drawn from the filtered objects, and the full
+// sentence is evaluated on every valid world that remains, 64 at a time with
+// the batch evaluator when the sentence compiles for k.
+
+// Per-object constraints; attrs masks have bit (size index * 3 + shape index)
+struct object_constraints
+{
+	uint16_t all_attrs;
+	uint16_t name_attrs[6];
+	uint64_t name_cells[6];
+	uint8_t name_with[6];     // names that must be on the same object
+	uint8_t name_without[6];  // names that must not be on the same object
+};
+
+struct model_options
+{
+	int min_objects;
+	int max_objects;
+	int threads;              // 0 = number of online CPUs
+	const char* path;         // write satisfying worlds here if non-null
+};
+
+// Effects: Derives constraints every object of a model of s satisfies
+void derive_object_constraints(const struct sentence* s, struct object_constraints* oc);
+
+// Returns: true if object o may appear in a model under oc
+bool object_allowed(const struct object_constraints* oc, uint32_t o);
+
+// Effects: Counts the models of s for each level min_objects..max_objects into
+//   counts[k] (zeroing the rest), optionally streaming them to world files.
+//   Returns false on setup failure.
+bool count_models(uint32_t valid_objects[], int num_valid_objects, const struct sentence* s,
+	const struct model_options* opt, struct bn counts[MAX_OBJECTS_IN_WORLD + 1]);
+
+#endif /* #ifndef __MODELS_H__ */
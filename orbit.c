@@ -0,0 +1,128 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+#include "kernels.h"
+#include "orbit.h"
+
+struct orbit_state
+{
+	int k;
+	uint32_t world[MAX_OBJECTS_IN_WORLD];   // bodies, then the canonical names
+	uint64_t sum;                           // weights not yet in count
+	uint64_t canonical;
+	struct bn* count;
+	orbit_visitor visit;
+	void* ctx;
+};
+
+static const uint64_t factorial[NUM_LABELS + 1] = { 1, 1, 2, 6, 24, 120, 720 };
+
+// Effects: Moves the pending weights into the bignum count
+static void flush(struct orbit_state* s)
+{
+	struct bn add;
+	bignum_from_int(&add, s->sum);
+	bignum_add(s->count, &add, s->count);
+	s->sum = 0;
+}
+
+// Effects: Gives object i and those after it their names, the first unused name
+//   being used, with divisor = product of m! over the objects before i
+static void assign_names(struct orbit_state* s, int i, int used, uint64_t divisor)
+{
+	if(i == s->k)
+	{
+		uint64_t weight = factorial[NUM_LABELS] / (divisor * factorial[NUM_LABELS - used]);
+		s->canonical++;
+		s->sum += weight;
+		if(s->sum >> 62)
+			flush(s);
+		if(s->visit)
+			s->visit(s->world, s->k, weight, s->ctx);
+		return;
+	}
+
+	uint32_t body = s->world[i];
+	for(int m = 0; used + m <= NUM_LABELS; m++)
+	{
+		s->world[i] = body | (((1u << m) - 1) << used);
+		assign_names(s, i + 1, used + m, divisor * factorial[m]);
+	}
+	s->world[i] = body;
+}
+
+// Effects: Chooses body d of the world from bodies[start, end) and recurses
+static void choose_bodies(struct orbit_state* s, const uint32_t bodies[], int num_bodies, int d, int start, int end,
+	uint64_t centers, uint64_t edges)
+{
+	for(int b = start; b < end; b++)
+	{
+		uint64_t c = centers, e = edges;
+		uint32_t labels = 0;
+		if(!board_place(bodies[b], &c, &e, &labels))
+			continue;
+		s->world[d] = bodies[b];
+		if(d == s->k - 1)
+			assign_names(s, 0, 0, 1);
+		else
+			choose_bodies(s, bodies, num_bodies, d + 1, b + 1, num_bodies - s->k + d + 2, c, e);
+	}
+}
+
+bool orbit_enumerate(const uint32_t objects[], int num_objects, int objects_in_world, int first_lead, int last_lead,
+	struct bn* count, uint64_t* canonical, orbit_visitor visit, void* ctx)
+{
+	struct orbit_state s;
+	int num_bodies = 0;
+
+	// Distinct bodies, each with every label mask
+	uint32_t* bodies = malloc((num_objects / 64 + 1) * sizeof(*bodies));
+	if(!bodies)
+		return false;
+	for(int i = 0; i < num_objects; )
+	{
+		uint32_t body = objects[i] & ~ALL_LABELS;
+		int j = i;
+		while(j < num_objects && (objects[j] & ~ALL_LABELS) == body && OBJECT_LABELS(objects[j]) == j - i)
+			j++;
+		if(j - i != 64)
+		{
+			free(bodies);
+			return false;
+		}
+		bodies[num_bodies++] = body;
+		i = j;
+	}
+
+	s.k = objects_in_world;
+	s.sum = 0;
+	s.canonical = 0;
+	s.count = count;
+	s.visit = visit;
+	s.ctx = ctx;
+
+	// The empty world has no lead body; it belongs to the range starting at 0
+	if(objects_in_world == 0)
+	{
+		if(first_lead <= 0 && last_lead > 0)
+			assign_names(&s, 0, 0, 1);
+	}
+	else
+	{
+		if(last_lead > num_bodies - objects_in_world + 1)
+			last_lead = num_bodies - objects_in_world + 1;
+		if(first_lead < 0)
+			first_lead = 0;
+		if(first_lead < last_lead)
+			choose_bodies(&s, bodies, num_bodies, 0, first_lead, last_lead, 0, 0);
+	}
+
+	flush(&s);
+	if(canonical)
+		*canonical += s.canonical;
+	free(bodies);
+	return true;
+}
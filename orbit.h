@@ -0,0 +1,42 @@
+#ifndef __ORBIT_H__
+#define __ORBIT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bn.h"
+#include "tarski.h"
+
+// Enumeration of valid worlds up to renaming, one world per orbit of the six
+// names under S6.
+//
+// letter_check only asks that names are not shared, so permuting a-f maps valid
+// worlds to valid worlds, and the orbit of a world is fixed by its bodies (cell,
+// size, shape) and how many names each object carries. The canonical world of
+// an orbit hands out names in first-use order: in increasing body order, an
+// object with m names takes the next m of a, b, c, ... With m_i names on object
+// i and u = sum of m_i, the orbit has
+//   6! / (m_0! * ... * m_{k-1}! * (6 - u)!)
+// worlds, which is the weight each canonical world carries; the weights of a
+// level add up to its count. A level is its valid body combinations times the
+// C(k + 6, 6) ways to split at most six names among k objects, against (k+1)^6
+// label assignments in a plain enumeration, up to 720 times fewer at k = 12.
+//
+// Only name-blind work can use the orbits: sentences that mention a name tell
+// the worlds of an orbit apart.
+
+// Called once per canonical world with its orbit size; w is only valid for the
+// duration of the call
+typedef void (*orbit_visitor)(const uint32_t w[], int sizeof_w, uint64_t weight, void* ctx);
+
+// Requires: every body in objects appears with all 64 label masks (as in
+//   valid_objects), objects increasing, 0 <= objects_in_world <= MAX_OBJECTS_IN_WORLD
+// Modifies: *count, *canonical (if non-null)
+// Effects: Calls visit (if non-null) for the canonical world of every orbit of
+//   valid worlds of objects_in_world objects whose first body has its index, among
+//   the distinct bodies of objects, in [first_lead, last_lead). Adds the sum of the
+//   weights to *count and the number of canonical worlds to *canonical. Returns
+//   false if objects lacks the required structure.
+bool orbit_enumerate(const uint32_t objects[], int num_objects, int objects_in_world, int first_lead, int last_lead,
+	struct bn* count, uint64_t* canonical, orbit_visitor visit, void* ctx);
+
+#endif /* #ifndef __ORBIT_H__ */
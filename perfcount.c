@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "perfcount.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static const char* event_names[PERF_NUM_EVENTS] =
+{
+	"cycles", "instructions", "br-misses", "L1d-misses", "LLC-misses"
+};
+
+const char* perf_event_name(enum perf_event_id e)
+{
+	return event_names[e];
+}
+
+#ifdef __linux__
+static int open_event(uint32_t type, uint64_t config)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+bool perf_open(struct perf_counters* p)
+{
+	bool any = false;
+
+	p->error = 0;
+	for(int e = 0; e < PERF_NUM_EVENTS; e++)
+		p->fd[e] = -1;
+
+#ifdef __linux__
+	static const struct
+	{
+		uint32_t type;
+		uint64_t config;
+	} events[PERF_NUM_EVENTS] =
+	{
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	};
+
+	for(int e = 0; e < PERF_NUM_EVENTS; e++)
+	{
+		p->fd[e] = open_event(events[e].type, events[e].config);
+		if(p->fd[e] < 0)
+		{
+			if(!p->error)
+				p->error = errno;
+			p->fd[e] = -1;
+			continue;
+		}
+		ioctl(p->fd[e], PERF_EVENT_IOC_RESET, 0);
+		ioctl(p->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+		any = true;
+	}
+#else
+	p->error = ENOSYS;
+#endif
+	return any;
+}
+
+void perf_close(struct perf_counters* p)
+{
+	for(int e = 0; e < PERF_NUM_EVENTS; e++)
+	{
+		if(p->fd[e] >= 0)
+			close(p->fd[e]);
+		p->fd[e] = -1;
+	}
+}
+
+void perf_read(const struct perf_counters* p, struct perf_sample* s)
+{
+	struct timespec ts;
+
+	for(int e = 0; e < PERF_NUM_EVENTS; e++)
+	{
+		uint64_t v[3];   // value, time enabled, time running
+
+		s->valid[e] = false;
+		s->value[e] = 0;
+		if(p->fd[e] < 0 || read(p->fd[e], v, sizeof(v)) != sizeof(v))
+			continue;
+		s->value[e] = v[2] && v[2] < v[1] ? (uint64_t)((double)v[0] * v[1] / v[2]) : v[0];
+		s->valid[e] = true;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	s->seconds = ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void perf_diff(const struct perf_sample* start, const struct perf_sample* end, struct perf_sample* delta)
+{
+	delta->seconds = end->seconds - start->seconds;
+	for(int e = 0; e < PERF_NUM_EVENTS; e++)
+	{
+		delta->valid[e] = start->valid[e] && end->valid[e];
+		delta->value[e] = delta->valid[e] ? end->value[e] - start->value[e] : 0;
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef __PERFCOUNT_H__
+#define __PERFCOUNT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Hardware performance counters through perf_event_open, for timing phases of
+// the enumerator without gprof's instrumentation.
+//
+// Every event is opened on its own for the calling thread (user space only), so
+// a machine or container that lacks one of them still reports the rest; where
+// perf_event_open is missing or forbidden altogether (perf_event_paranoid,
+// seccomp, non-Linux builds) only the wall-clock time is measured. Values of
+// multiplexed counters are scaled by time enabled / time running.
+
+enum perf_event_id
+{
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_BRANCH_MISSES,
+	PERF_L1D_MISSES,        // L1 data cache read misses
+	PERF_LLC_MISSES,        // last-level cache read misses
+	PERF_NUM_EVENTS
+};
+
+struct perf_counters
+{
+	int fd[PERF_NUM_EVENTS];        // -1 if the event is unavailable
+	int error;                      // errno of the first failed open, 0 if none
+};
+
+struct perf_sample
+{
+	double seconds;
+	uint64_t value[PERF_NUM_EVENTS];
+	bool valid[PERF_NUM_EVENTS];
+};
+
+// Effects: Opens and starts the counters. Returns true if at least one works.
+bool perf_open(struct perf_counters* p);
+void perf_close(struct perf_counters* p);
+
+// Effects: Reads the current totals
+void perf_read(const struct perf_counters* p, struct perf_sample* s);
+
+// Effects: *delta = end - start, valid where both are
+void perf_diff(const struct perf_sample* start, const struct perf_sample* end, struct perf_sample* delta);
+
+// Returns: short column name of event e
+const char* perf_event_name(enum perf_event_id e);
+
+#endif /* #ifndef __PERFCOUNT_H__ */
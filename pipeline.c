@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "bn.h"
+#include "tarski.h"
+#include "kernels.h"
+#include "pipeline.h"
+
+#define SPIN_TRIES 64   // failed ring operations before yielding
+
+struct pipeline_block
+{
+	int num;                // tuples in the block
+	uint64_t accepted;      // set by the validator
+	uint16_t indices[];     // num * objects_in_world indices into valid_objects
+};
+
+struct ring_slot
+{
+	uint64_t seq;
+	struct pipeline_block* block;
+};
+
+// Bounded MPMC queue of blocks. Slot i is free for the producer at position pos
+// when its seq equals pos, and full for the consumer when it equals pos + 1.
+struct ring
+{
+	struct ring_slot* slots;
+	uint64_t mask;
+	uint64_t head __attribute__((aligned(64)));   // next position to pop
+	uint64_t tail __attribute__((aligned(64)));   // next position to push
+};
+
+struct pipeline
+{
+	uint32_t* objects;
+	int num_objects;
+	int objects_in_world;
+	int block_size;
+	int leads;
+	int next_lead;
+	int generators_left;
+	int validators;
+	struct ring free_blocks;
+	struct ring generated;
+	struct ring validated;
+};
+
+struct pipeline_thread
+{
+	struct pipeline* p;
+	struct pipeline_stage_stats stats;
+	pthread_t tid;
+};
+
+// Marks the end of the stream; never part of the pool
+static struct pipeline_block end_of_stream;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool ring_init(struct ring* r, int min_slots)
+{
+	uint64_t n = 1;
+	while(n < (uint64_t)min_slots)
+		n *= 2;
+	memset(r, 0, sizeof(*r));
+	r->slots = malloc(n * sizeof(*r->slots));
+	if(!r->slots)
+		return false;
+	for(uint64_t i = 0; i < n; i++)
+		r->slots[i].seq = i;
+	r->mask = n - 1;
+	return true;
+}
+
+static bool ring_push(struct ring* r, struct pipeline_block* b)
+{
+	uint64_t pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+	struct ring_slot* slot;
+	while(true)
+	{
+		slot = &r->slots[pos & r->mask];
+		int64_t dif = (int64_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+		if(dif == 0)
+		{
+			if(__atomic_compare_exchange_n(&r->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if(dif < 0)
+			return false;   // full
+		else
+			pos = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+	}
+	slot->block = b;
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static struct pipeline_block* ring_pop(struct ring* r)
+{
+	uint64_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+	struct ring_slot* slot;
+	while(true)
+	{
+		slot = &r->slots[pos & r->mask];
+		int64_t dif = (int64_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+		if(dif == 0)
+		{
+			if(__atomic_compare_exchange_n(&r->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if(dif < 0)
+			return NULL;    // empty
+		else
+			pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+	}
+	struct pipeline_block* b = slot->block;
+	__atomic_store_n(&slot->seq, pos + r->mask + 1, __ATOMIC_RELEASE);
+	return b;
+}
+
+// Effects: Pushes b, waiting while r is full; adds the time waited to *waited
+static void ring_push_wait(struct ring* r, struct pipeline_block* b, double* waited)
+{
+	if(ring_push(r, b))
+		return;
+	double start = now();
+	for(int tries = 1; !ring_push(r, b); tries++)
+		if(tries >= SPIN_TRIES)
+			sched_yield();
+	*waited += now() - start;
+}
+
+// Effects: Pops a block, waiting while r is empty; adds the time waited to *waited
+static struct pipeline_block* ring_pop_wait(struct ring* r, double* waited)
+{
+	struct pipeline_block* b = ring_pop(r);
+	if(b)
+		return b;
+	double start = now();
+	for(int tries = 1; !(b = ring_pop(r)); tries++)
+		if(tries >= SPIN_TRIES)
+			sched_yield();
+	*waited += now() - start;
+	return b;
+}
+
+// Effects: Advances indices[1..k-1] to the next combination of objects after
+//   indices[0]. Returns false when there is none.
+static bool next_combination(int indices[], int k, int n)
+{
+	int y;
+	for(y = k - 1; y >= 1; y--)
+		if(indices[y] != y + n - k)
+			break;
+	if(y < 1)
+		return false;
+	indices[y]++;
+	for(int z = y + 1; z < k; z++)
+		indices[z] = indices[z - 1] + 1;
+	return true;
+}
+
+static void* generator_main(void* arg)
+{
+	struct pipeline_thread* t = arg;
+	struct pipeline* p = t->p;
+	int k = p->objects_in_world;
+	int indices[MAX_OBJECTS_IN_WORLD];
+	struct pipeline_block* b = NULL;
+	double start = now();
+
+	// Leads are handed out one at a time; low leads carry most of the work
+	while(true)
+	{
+		int lead = __atomic_fetch_add(&p->next_lead, 1, __ATOMIC_RELAXED);
+		if(lead >= p->leads)
+			break;
+		for(int y = 0; y < k; y++)
+			indices[y] = lead + y;
+		do
+		{
+			if(!b)
+			{
+				b = ring_pop_wait(&p->free_blocks, &t->stats.wait_in);
+				b->num = 0;
+			}
+			uint16_t* tuple = b->indices + (size_t)b->num * k;
+			for(int y = 0; y < k; y++)
+				tuple[y] = indices[y];
+			if(++b->num == p->block_size)
+			{
+				ring_push_wait(&p->generated, b, &t->stats.wait_out);
+				t->stats.blocks++;
+				b = NULL;
+			}
+		} while(next_combination(indices, k, p->num_objects));
+	}
+	if(b)
+	{
+		ring_push_wait(&p->generated, b, &t->stats.wait_out);
+		t->stats.blocks++;
+	}
+
+	// The last generator to finish tells every validator
+	if(__atomic_sub_fetch(&p->generators_left, 1, __ATOMIC_ACQ_REL) == 0)
+		for(int v = 0; v < p->validators; v++)
+			ring_push_wait(&p->generated, &end_of_stream, &t->stats.wait_out);
+
+	t->stats.busy = now() - start - t->stats.wait_in - t->stats.wait_out;
+	return NULL;
+}
+
+static void* validator_main(void* arg)
+{
+	struct pipeline_thread* t = arg;
+	struct pipeline* p = t->p;
+	int k = p->objects_in_world;
+	uint32_t w[MAX_OBJECTS_IN_WORLD];
+	check_kernel check = check_kernels[k];
+	double start = now();
+
+	while(true)
+	{
+		struct pipeline_block* b = ring_pop_wait(&p->generated, &t->stats.wait_in);
+		if(b != &end_of_stream)
+		{
+			uint64_t accepted = 0;
+			const uint16_t* tuple = b->indices;
+			for(int i = 0; i < b->num; i++, tuple += k)
+			{
+				for(int y = 0; y < k; y++)
+					w[y] = p->objects[tuple[y]];
+				accepted += check(w);
+			}
+			b->accepted = accepted;
+			t->stats.blocks++;
+		}
+		ring_push_wait(&p->validated, b, &t->stats.wait_out);
+		if(b == &end_of_stream)
+			break;
+	}
+
+	t->stats.busy = now() - start - t->stats.wait_in - t->stats.wait_out;
+	return NULL;
+}
+
+bool pipeline_count(uint32_t valid_objects[], int num_valid_objects, const struct pipeline_options* opt,
+	struct bn* count, struct pipeline_stage_stats stats[NUM_STAGES], double* wall)
+{
+	int k = opt->objects_in_world;
+	int generators = opt->generators > 0 ? opt->generators : 1;
+	int validators = opt->validators > 0 ? opt->validators : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(validators <= 0)
+		validators = 1;
+	int block_size = opt->block_size > 0 ? opt->block_size : 4096;
+	int num_blocks = opt->blocks > 0 ? opt->blocks : 4 * (generators + validators);
+
+	bignum_init(count);
+	memset(stats, 0, NUM_STAGES * sizeof(*stats));
+	stats[STAGE_GENERATE].threads = generators;
+	stats[STAGE_VALIDATE].threads = validators;
+	stats[STAGE_REDUCE].threads = 1;
+	*wall = 0;
+
+	// Tuples hold 16-bit indices
+	if(num_valid_objects > UINT16_MAX + 1)
+		return false;
+	if(k == 0)
+	{
+		bignum_inc(count);
+		return true;
+	}
+	if(num_valid_objects < k)
+		return true;
+
+	struct pipeline p = { 0 };
+	p.objects = valid_objects;
+	p.num_objects = num_valid_objects;
+	p.objects_in_world = k;
+	p.block_size = block_size;
+	p.leads = num_valid_objects - k + 1;
+	p.generators_left = generators;
+	p.validators = validators;
+
+	// Whole cache lines per block, so neighbouring blocks never share one
+	size_t block_bytes = (sizeof(struct pipeline_block) + (size_t)block_size * k * sizeof(uint16_t) + 63) & ~(size_t)63;
+	char* pool = aligned_alloc(64, num_blocks * block_bytes);
+	struct pipeline_thread* threads = calloc(generators + validators, sizeof(*threads));
+	// Every ring can hold the whole pool plus the end markers, so a push waits
+	// only for a slot being handed over
+	bool ok = pool && threads && ring_init(&p.free_blocks, num_blocks)
+		&& ring_init(&p.generated, num_blocks + validators) && ring_init(&p.validated, num_blocks + validators);
+	for(int i = 0; ok && i < num_blocks; i++)
+		ring_push(&p.free_blocks, (struct pipeline_block*)(pool + i * block_bytes));
+
+	// Validators first: generators are only useful with someone to consume
+	double start = now();
+	int started_validators = 0, started_generators = 0;
+	for(int v = 0; ok && v < validators; v++)
+	{
+		threads[generators + v].p = &p;
+		if(pthread_create(&threads[generators + v].tid, NULL, validator_main, &threads[generators + v]) != 0)
+			break;
+		started_validators++;
+	}
+	p.validators = started_validators;
+	for(int g = 0; ok && started_validators && g < generators; g++)
+	{
+		threads[g].p = &p;
+		if(pthread_create(&threads[g].tid, NULL, generator_main, &threads[g]) != 0)
+			break;
+		started_generators++;
+	}
+	if(ok && (started_validators < validators || started_generators < generators))
+	{
+		fprintf(stderr, "pthread_create failed\n");
+		ok = false;
+		// Wind down what started: no leads left, and the end markers the missing
+		// generators would have sent
+		__atomic_store_n(&p.next_lead, p.leads, __ATOMIC_RELAXED);
+		if(started_validators && __atomic_sub_fetch(&p.generators_left, generators - started_generators, __ATOMIC_ACQ_REL) == 0)
+			for(int v = 0; v < started_validators; v++)
+				ring_push(&p.generated, &end_of_stream);
+	}
+
+	// Reduce on this thread
+	struct pipeline_stage_stats* r = &stats[STAGE_REDUCE];
+	struct bn n;
+	for(int ended = 0; ended < started_validators; )
+	{
+		struct pipeline_block* b = ring_pop_wait(&p.validated, &r->wait_in);
+		if(b == &end_of_stream)
+		{
+			ended++;
+			continue;
+		}
+		double t0 = now();
+		bignum_from_int(&n, b->accepted);
+		bignum_add(count, &n, count);
+		r->blocks++;
+		r->busy += now() - t0;
+		ring_push_wait(&p.free_blocks, b, &r->wait_out);
+	}
+
+	for(int i = 0; i < generators + validators; i++)
+	{
+		if(i < generators ? i >= started_generators : i - generators >= started_validators)
+			continue;
+		pthread_join(threads[i].tid, NULL);
+		struct pipeline_stage_stats* s = &stats[i < generators ? STAGE_GENERATE : STAGE_VALIDATE];
+		s->blocks += threads[i].stats.blocks;
+		s->busy += threads[i].stats.busy;
+		s->wait_in += threads[i].stats.wait_in;
+		s->wait_out += threads[i].stats.wait_out;
+	}
+	*wall = now() - start;
+
+	free(p.free_blocks.slots);
+	free(p.generated.slots);
+	free(p.validated.slots);
+	free(threads);
+	free(pool);
+	return ok;
+}
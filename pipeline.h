@@ -0,0 +1,57 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bn.h"
+#include "tarski.h"
+
+// Pipelined counting of one level: the work the default loop interleaves on one
+// thread is split into stages connected by lock-free rings.
+//
+//   generators  take lead objects one at a time and write the index tuples of all
+//               combinations with that lead into blocks
+//   validators  build each world of a block from valid_objects, run check_world
+//               and store the number accepted in the block
+//   reducer     (the calling thread) folds the accepted counts into a struct bn
+//
+// A fixed pool of blocks circulates free -> generated -> validated -> free through
+// three bounded multi-producer multi-consumer rings (one slot sequence number per
+// entry, claimed with compare-and-swap). Generators cannot run further ahead than
+// the pool allows: they wait for a free block, which is the backpressure. Stages
+// spin briefly and then yield while waiting, and time spent waiting is reported
+// separately from time spent working.
+
+enum pipeline_stage
+{
+	STAGE_GENERATE,
+	STAGE_VALIDATE,
+	STAGE_REDUCE,
+	NUM_STAGES
+};
+
+struct pipeline_options
+{
+	int objects_in_world;
+	int generators;         // 0 = 1
+	int validators;         // 0 = number of online CPUs
+	int block_size;         // tuples per block, 0 = 4096
+	int blocks;             // blocks in flight, 0 = 4 per thread
+};
+
+struct pipeline_stage_stats
+{
+	int threads;
+	uint64_t blocks;        // blocks handled
+	double busy;            // seconds working, summed over threads
+	double wait_in;         // seconds waiting for a block to work on
+	double wait_out;        // seconds waiting to pass a block on
+};
+
+// Requires: 0 <= objects_in_world <= MAX_OBJECTS_IN_WORLD
+// Effects: *count = number of valid worlds of objects_in_world objects, stats[s]
+//   and *wall describe the run. Returns false on setup failure.
+bool pipeline_count(uint32_t valid_objects[], int num_valid_objects, const struct pipeline_options* opt,
+	struct bn* count, struct pipeline_stage_stats stats[NUM_STAGES], double* wall);
+
+#endif /* #ifndef __PIPELINE_H__ */
@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+#include "query.h"
+#include "coordinator.h"
+
+#define QUERY_LINE_MAX 1024
+#define QUERY_MAX_CLIENTS 64
+
+// Names of the size and shape indices used by count.h
+static const char* size_names[NUM_SIZES] = { "large", "medium", "small" };
+static const char* shape_names[NUM_SHAPES] = { "dodec", "cube", "tet" };
+
+// Effects: Parses a comma-separated list of names into a bit mask, -1 on error
+static int parse_name_list(char* value, const char* names[], int count)
+{
+	int mask = 0;
+	char* save;
+	for(char* item = strtok_r(value, ",", &save); item; item = strtok_r(NULL, ",", &save))
+	{
+		int i;
+		for(i = 0; i < count; i++)
+			if(!strcmp(item, names[i]))
+				break;
+		if(i == count)
+			return -1;
+		mask |= 1 << i;
+	}
+	return mask;
+}
+
+// Effects: Parses letters a-f into a label mask, -1 on error
+static int parse_labels(const char* value)
+{
+	int mask = 0;
+	for(; *value; value++)
+	{
+		if(*value < 'a' || *value >= 'a' + NUM_LABELS)
+			return -1;
+		mask |= 1 << (*value - 'a');
+	}
+	return mask;
+}
+
+// Effects: Parses "A" or "A-B" into [*lo, *hi], false on error
+static bool parse_range(const char* value, int* lo, int* hi)
+{
+	char* end;
+	*lo = (int)strtol(value, &end, 10);
+	*hi = *lo;
+	if(end == value)
+		return false;
+	if(*end == '-')
+	{
+		value = end + 1;
+		*hi = (int)strtol(value, &end, 10);
+		if(end == value)
+			return false;
+	}
+	return *end == 0 && *lo <= *hi;
+}
+
+enum query_status query_answer(const struct count_tables* t, char* line, char* reply, size_t reply_size)
+{
+	struct world_filter f;
+	int k_lo = 0, k_hi = MAX_OBJECTS_IN_WORLD;
+	char* save;
+
+	world_filter_all(&f);
+
+	char* cmd = strtok_r(line, " \t\r", &save);
+	if(!cmd)
+	{
+		snprintf(reply, reply_size, "error empty request");
+		return QUERY_REPLY;
+	}
+	if(!strcmp(cmd, "quit"))
+		return QUERY_QUIT;
+	if(!strcmp(cmd, "shutdown"))
+		return QUERY_SHUTDOWN;
+	if(strcmp(cmd, "count"))
+	{
+		snprintf(reply, reply_size, "error unknown command %s", cmd);
+		return QUERY_REPLY;
+	}
+
+	for(char* arg = strtok_r(NULL, " \t\r", &save); arg; arg = strtok_r(NULL, " \t\r", &save))
+	{
+		char* value = strchr(arg, '=');
+		int mask = 0;
+		bool ok = value != NULL;
+		if(ok)
+			*value++ = 0;
+
+		if(!ok)
+			;
+		else if(!strcmp(arg, "k"))
+			ok = parse_range(value, &k_lo, &k_hi) && k_lo >= 0 && k_hi <= MAX_OBJECTS_IN_WORLD;
+		else if(!strcmp(arg, "sizes"))
+		{
+			mask = parse_name_list(value, size_names, NUM_SIZES);
+			ok = mask >= 0;
+			f.sizes = mask;
+		}
+		else if(!strcmp(arg, "shapes"))
+		{
+			mask = parse_name_list(value, shape_names, NUM_SHAPES);
+			ok = mask >= 0;
+			f.shapes = mask;
+		}
+		else if(!strcmp(arg, "names") || !strcmp(arg, "used"))
+		{
+			mask = parse_labels(value);
+			ok = mask >= 0;
+			if(arg[0] == 'n')
+				f.names = mask;
+			else
+				f.required = mask;
+		}
+		else if(!strcmp(arg, "cells"))
+		{
+			char* end;
+			f.region = strtoull(value, &end, 16);
+			ok = end != value && *end == 0;
+		}
+		else if(!strcmp(arg, "region"))
+		{
+			int x0, x1, y0, y1;
+			char* comma = strchr(value, ',');
+			ok = comma != NULL;
+			if(ok)
+			{
+				*comma = 0;
+				ok = parse_range(value, &x0, &x1) && parse_range(comma + 1, &y0, &y1)
+					&& x0 >= 0 && x1 < 8 && y0 >= 0 && y1 < 8;
+			}
+			if(ok)
+			{
+				f.region = 0;
+				for(int x = x0; x <= x1; x++)
+					for(int y = y0; y <= y1; y++)
+						f.region |= 1ULL << (x * 8 + y);
+			}
+		}
+		else
+			ok = false;
+
+		if(!ok)
+		{
+			snprintf(reply, reply_size, "error bad argument %s", arg);
+			return QUERY_REPLY;
+		}
+	}
+
+	struct bn total, level;
+	char buf[400];
+	bignum_init(&total);
+	for(int k = k_lo; k <= k_hi; k++)
+	{
+		count_worlds(t, k, &f, &level);
+		bignum_add(&total, &level, &total);
+	}
+	bignum_to_decimal(&total, buf, sizeof(buf));
+	snprintf(reply, reply_size, "ok %s", buf);
+	return QUERY_REPLY;
+}
+
+static bool send_line(int fd, const char* reply)
+{
+	size_t len = strlen(reply);
+	char buf[QUERY_LINE_MAX + 2];
+	memcpy(buf, reply, len);
+	buf[len++] = '\n';
+
+	const char* p = buf;
+	while(len)
+	{
+		ssize_t n = write(fd, p, len);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+// One connected client and its partial input line
+struct query_client
+{
+	int fd;
+	char buf[QUERY_LINE_MAX];
+	size_t len;
+};
+
+// Effects: Answers every complete line in c->buf. Returns QUERY_QUIT when the
+//   client should be dropped, QUERY_SHUTDOWN to stop the server.
+static enum query_status serve_lines(const struct count_tables* t, struct query_client* c)
+{
+	char reply[QUERY_LINE_MAX];
+	char* nl;
+
+	while((nl = memchr(c->buf, '\n', c->len)))
+	{
+		*nl = 0;
+		enum query_status st = query_answer(t, c->buf, reply, sizeof(reply));
+		if(st != QUERY_REPLY)
+			return st;
+		if(!send_line(c->fd == 0 ? 1 : c->fd, reply))
+			return QUERY_QUIT;
+
+		size_t used = nl + 1 - c->buf;
+		memmove(c->buf, nl + 1, c->len - used);
+		c->len -= used;
+	}
+	if(c->len == sizeof(c->buf))
+	{
+		send_line(c->fd == 0 ? 1 : c->fd, "error line too long");
+		return QUERY_QUIT;
+	}
+	return QUERY_REPLY;
+}
+
+// Effects: Reads what is available from c. Returns false on end of input.
+static bool client_read(struct query_client* c)
+{
+	ssize_t n;
+	do
+		n = read(c->fd, c->buf + c->len, sizeof(c->buf) - c->len);
+	while(n < 0 && errno == EINTR);
+	if(n <= 0)
+		return false;
+	c->len += n;
+	return true;
+}
+
+int run_query_server(const struct count_tables* t, const char* socket_path)
+{
+	if(!socket_path)
+	{
+		// stdin/stdout: one client, unbuffered so replies can be pipelined
+		static struct query_client in;
+		in.fd = 0;
+		while(client_read(&in))
+			if(serve_lines(t, &in) != QUERY_REPLY)
+				break;
+		return 0;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	int listen_fd = listen_socket(socket_path, 16);
+	if(listen_fd < 0)
+		return 1;
+	fprintf(stderr, "Query server listening on %s\n", socket_path);
+
+	static struct query_client clients[QUERY_MAX_CLIENTS];
+	struct pollfd fds[QUERY_MAX_CLIENTS + 1];
+	for(int i = 0; i < QUERY_MAX_CLIENTS; i++)
+		clients[i].fd = -1;
+
+	bool running = true;
+	while(running)
+	{
+		fds[0].fd = listen_fd;
+		fds[0].events = POLLIN;
+		for(int i = 0; i < QUERY_MAX_CLIENTS; i++)
+		{
+			fds[i + 1].fd = clients[i].fd;
+			fds[i + 1].events = POLLIN;
+			fds[i + 1].revents = 0;
+		}
+
+		if(poll(fds, QUERY_MAX_CLIENTS + 1, -1) < 0)
+		{
+			if(errno == EINTR) continue;
+			perror("poll");
+			break;
+		}
+
+		if(fds[0].revents & POLLIN)
+		{
+			int fd = accept(listen_fd, NULL, NULL);
+			int slot = -1;
+			for(int i = 0; i < QUERY_MAX_CLIENTS && fd >= 0; i++)
+				if(clients[i].fd < 0) { slot = i; break; }
+			if(slot >= 0)
+			{
+				clients[slot].fd = fd;
+				clients[slot].len = 0;
+			}
+			else if(fd >= 0)
+			{
+				send_line(fd, "error too many clients");
+				close(fd);
+			}
+		}
+
+		for(int i = 0; i < QUERY_MAX_CLIENTS && running; i++)
+		{
+			struct query_client* c = &clients[i];
+			if(c->fd < 0 || !(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+
+			enum query_status st = client_read(c) ? serve_lines(t, c) : QUERY_QUIT;
+			if(st == QUERY_SHUTDOWN)
+				running = false;
+			if(st != QUERY_REPLY)
+			{
+				close(c->fd);
+				c->fd = -1;
+			}
+		}
+	}
+
+	for(int i = 0; i < QUERY_MAX_CLIENTS; i++)
+		if(clients[i].fd >= 0)
+			close(clients[i].fd);
+	close(listen_fd);
+	unlink(socket_path);
+	return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef __QUERY_H__
+#define __QUERY_H__
+
+#include <stddef.h>
+#include "count.h"
+
+// Line protocol for the query daemon. One request per line, one reply per line.
+//
+//   count [k=N | k=A-B] [sizes=small,medium,large] [shapes=tet,cube,dodec]
+//         [names=abcdef] [used=abc] [region=X0-X1,Y0-Y1] [cells=HEX]
+//     -> "ok <decimal count>"   (k defaults to 0-MAX_OBJECTS_IN_WORLD, summed)
+//   quit      -> closes this connection
+//   shutdown  -> stops the daemon
+//   anything else -> "error <reason>"
+//
+// names restricts which names objects may carry, used lists names that must
+// appear in the world, region/cells restrict where objects may stand.
+
+enum query_status
+{
+	QUERY_REPLY,
+	QUERY_QUIT,
+	QUERY_SHUTDOWN
+};
+
+// Requires: line is a NUL-terminated request without the newline
+// Effects: Writes the reply (without newline) into reply
+enum query_status query_answer(const struct count_tables* t, char* line, char* reply, size_t reply_size);
+
+// Effects: Answers requests from stdin (socket_path NULL) or from any number of
+//   clients on a Unix domain socket until shutdown, keeping t resident
+int run_query_server(const struct count_tables* t, const char* socket_path);
+
+#endif /* #ifndef __QUERY_H__ */
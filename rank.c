@@ -0,0 +1,188 @@
+#include <string.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+#include "rank.h"
+
+void ranker_init(struct world_ranker* r, const struct count_tables* t)
+{
+	memset(r, 0, sizeof(*r));
+	memset(r->attr_index, -1, sizeof(r->attr_index));
+
+	// Pairs in (size index, shape index) order, as elsewhere
+	for(int size = 0; size < NUM_SIZES; size++)
+	{
+		for(int shape = 0; shape < NUM_SHAPES; shape++)
+		{
+			if(!((t->attrs[size] >> shape) & 1))
+				continue;
+			r->attr_index[1 << size][1 << shape] = r->num_attrs;
+			r->attr_bits[r->num_attrs++] = (1 << (15 + size)) | (1 << (12 + shape));
+		}
+	}
+
+	for(int n = 0; n <= NUM_CELLS; n++)
+		for(int k = 0; k <= MAX_OBJECTS_IN_WORLD; k++)
+			r->binom[n][k] = k == 0 ? 1 : n == 0 ? 0 : r->binom[n - 1][k - 1] + r->binom[n - 1][k];
+
+	for(int k = 0; k <= MAX_OBJECTS_IN_WORLD; k++)
+	{
+		r->attr_ways[k] = 1;
+		r->name_ways[k] = 1;
+		for(int i = 0; i < k; i++)
+			r->attr_ways[k] *= r->num_attrs;
+		for(int n = 0; n < NUM_LABELS; n++)
+			r->name_ways[k] *= k + 1;
+
+		uint64_t count;
+		r->fits64[k] = !__builtin_mul_overflow(r->binom[NUM_CELLS][k], r->attr_ways[k], &count)
+			&& !__builtin_mul_overflow(count, r->name_ways[k], &count);
+	}
+}
+
+void ranker_count(const struct world_ranker* r, int k, struct bn* count)
+{
+	struct bn cells, low;
+	bignum_from_int(&cells, r->binom[NUM_CELLS][k]);
+	bignum_from_int(&low, r->attr_ways[k] * r->name_ways[k]);
+	bignum_mul_words(&cells, &low, count);
+}
+
+// Effects: Splits world w into its cell rank and the (attrs, names) rest of its ID
+static bool split_world(const struct world_ranker* r, const uint32_t w[], int k, uint64_t* cells, uint64_t* low)
+{
+	uint32_t s[MAX_OBJECTS_IN_WORLD];
+
+	if(k < 0 || k > MAX_OBJECTS_IN_WORLD)
+		return false;
+
+	// Cell order
+	for(int i = 0; i < k; i++)
+	{
+		uint32_t o = w[i];
+		int j = i - 1;
+		while(j >= 0 && OBJECT_CELL(s[j]) > OBJECT_CELL(o))
+		{
+			s[j + 1] = s[j];
+			j--;
+		}
+		s[j + 1] = o;
+	}
+
+	uint8_t used = 0;
+	uint64_t attrs = 0, names = 0;
+	*cells = 0;
+	for(int i = k - 1; i >= 0; i--)
+	{
+		int a = r->attr_index[OBJECT_SIZE(s[i])][OBJECT_SHAPE(s[i])];
+		if(a < 0 || (s[i] >> 18) || (i > 0 && OBJECT_CELL(s[i - 1]) == OBJECT_CELL(s[i])) || (used & OBJECT_LABELS(s[i])))
+			return false;
+		used |= OBJECT_LABELS(s[i]);
+		*cells += r->binom[OBJECT_CELL(s[i])][i + 1];
+		attrs = attrs * r->num_attrs + a;
+	}
+	for(int n = NUM_LABELS - 1; n >= 0; n--)
+	{
+		int digit = 0;
+		for(int i = 0; i < k; i++)
+			if((s[i] >> n) & 1)
+				digit = i + 1;
+		names = names * (k + 1) + digit;
+	}
+	*low = attrs * r->name_ways[k] + names;
+	return true;
+}
+
+// Effects: Builds the world from its cell rank and the rest of its ID
+static void join_world(const struct world_ranker* r, int k, uint64_t cells, uint64_t low, uint32_t w[])
+{
+	uint64_t attrs = low / r->name_ways[k];
+	uint64_t names = low % r->name_ways[k];
+
+	// Largest cells first: c_i is the largest c with C(c, i + 1) <= what is left
+	int c = NUM_CELLS;
+	for(int i = k - 1; i >= 0; i--)
+	{
+		do
+			c--;
+		while(r->binom[c][i + 1] > cells);
+		cells -= r->binom[c][i + 1];
+		w[i] = c << 6;
+	}
+	for(int i = 0; i < k; i++)
+	{
+		w[i] |= r->attr_bits[attrs % r->num_attrs];
+		attrs /= r->num_attrs;
+	}
+	for(int n = 0; n < NUM_LABELS; n++)
+	{
+		int digit = names % (k + 1);
+		names /= k + 1;
+		if(digit)
+			w[digit - 1] |= 1 << n;
+	}
+
+	// Increasing object order
+	for(int i = 1; i < k; i++)
+	{
+		uint32_t v = w[i];
+		int j = i - 1;
+		while(j >= 0 && w[j] > v)
+		{
+			w[j + 1] = w[j];
+			j--;
+		}
+		w[j + 1] = v;
+	}
+}
+
+bool world_rank(const struct world_ranker* r, const uint32_t w[], int k, struct bn* id)
+{
+	uint64_t cells, low;
+	struct bn a, b;
+
+	if(!split_world(r, w, k, &cells, &low))
+		return false;
+	bignum_from_int(&a, cells);
+	bignum_from_int(&b, r->attr_ways[k] * r->name_ways[k]);
+	bignum_mul_words(&a, &b, id);
+	bignum_from_int(&a, low);
+	bignum_add(id, &a, id);
+	return true;
+}
+
+bool world_unrank(const struct world_ranker* r, int k, struct bn* id, uint32_t w[])
+{
+	struct bn count, radix, cells, low;
+
+	if(k < 0 || k > MAX_OBJECTS_IN_WORLD)
+		return false;
+	ranker_count(r, k, &count);
+	if(bignum_cmp(id, &count) != SMALLER)
+		return false;
+	bignum_from_int(&radix, r->attr_ways[k] * r->name_ways[k]);
+	bignum_divmod(id, &radix, &cells, &low);
+	join_world(r, k, bignum_low64(&cells), bignum_low64(&low), w);
+	return true;
+}
+
+bool world_rank64(const struct world_ranker* r, const uint32_t w[], int k, uint64_t* id)
+{
+	uint64_t cells, low;
+
+	if(k < 0 || k > MAX_OBJECTS_IN_WORLD || !r->fits64[k] || !split_world(r, w, k, &cells, &low))
+		return false;
+	*id = cells * (r->attr_ways[k] * r->name_ways[k]) + low;
+	return true;
+}
+
+bool world_unrank64(const struct world_ranker* r, int k, uint64_t id, uint32_t w[])
+{
+	if(k < 0 || k > MAX_OBJECTS_IN_WORLD || !r->fits64[k])
+		return false;
+	uint64_t radix = r->attr_ways[k] * r->name_ways[k];
+	if(id / radix >= r->binom[NUM_CELLS][k])
+		return false;
+	join_world(r, k, id / radix, id % radix, w);
+	return true;
+}
@@ -0,0 +1,58 @@
+#ifndef __RANK_H__
+#define __RANK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+
+// Dense world IDs: a bijection between the valid worlds of k objects and
+// 0 .. count(k) - 1, so per-world data can live in flat arrays indexed by ID and
+// ID ranges shard exactly the valid worlds.
+//
+// It follows the product structure of count.h. With the objects of a world in
+// cell order, the ID is the mixed-radix number
+//   (cells, attrs, names) in radix (C(64, k), A^k, (k+1)^6)
+// where
+//   cells  ranks the set of occupied cells in colex order: sum of C(c_i, i + 1)
+//          over the cells c_0 < c_1 < ...
+//   attrs  has digit i = index of the (size, shape) pair of object i among the A
+//          pairs valid_objects has, digit 0 least significant
+//   names  has digit n = 0 if name n is unused, else 1 + the position of the
+//          object carrying it, name a least significant
+// Each part fits in 64 bits for k <= MAX_OBJECTS_IN_WORLD, and so does the
+// product of the last two radices; only the full ID can exceed 64 bits, from
+// k = 7 on. The 64-bit functions serve the levels where it does not.
+
+struct world_ranker
+{
+	int num_attrs;
+	uint32_t attr_bits[NUM_ATTRS];               // size and shape bits of each pair
+	int8_t attr_index[8][8];                     // [size bits][shape bits] -> pair, -1 if none
+	uint64_t binom[NUM_CELLS + 1][MAX_OBJECTS_IN_WORLD + 1];
+	uint64_t attr_ways[MAX_OBJECTS_IN_WORLD + 1];   // A^k
+	uint64_t name_ways[MAX_OBJECTS_IN_WORLD + 1];   // (k+1)^6
+	bool fits64[MAX_OBJECTS_IN_WORLD + 1];         // count(k) < 2^64
+};
+
+// Effects: Prepares r from the counting tables of valid_objects
+void ranker_init(struct world_ranker* r, const struct count_tables* t);
+
+// Effects: *count = number of valid worlds of k objects
+void ranker_count(const struct world_ranker* r, int k, struct bn* count);
+
+// Effects: Sets *id to the ID of world w (objects in any order). Returns false if
+//   w is not a valid world of objects from valid_objects.
+bool world_rank(const struct world_ranker* r, const uint32_t w[], int k, struct bn* id);
+
+// Effects: Writes the world with ID id to w, objects in increasing order. Returns
+//   false if id >= count(k).
+bool world_unrank(const struct world_ranker* r, int k, struct bn* id, uint32_t w[]);
+
+// Same as world_rank and world_unrank for levels with fits64[k]; they also return
+// false on the other levels
+bool world_rank64(const struct world_ranker* r, const uint32_t w[], int k, uint64_t* id);
+bool world_unrank64(const struct world_ranker* r, int k, uint64_t id, uint32_t w[]);
+
+#endif /* #ifndef __RANK_H__ */
@@ -0,0 +1,65 @@
+#ifndef __RNG_H__
+#define __RNG_H__
+
+#include <stdint.h>
+
+// Small, fast pseudo-random generator shared by the sampling modes.
+// A (seed, stream) pair always produces the same sequence.
+
+// xoshiro256** seeded through splitmix64
+struct rng
+{
+	uint64_t s[4];
+};
+
+static inline uint64_t splitmix64(uint64_t* x)
+{
+	uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static inline void rng_seed(struct rng* r, uint64_t seed, uint64_t stream)
+{
+	uint64_t x = seed ^ (stream * 0xd1342543de82ef95ULL);
+	for(int i = 0; i < 4; i++)
+		r->s[i] = splitmix64(&x);
+}
+
+static inline uint64_t rng_next(struct rng* r)
+{
+	uint64_t* s = r->s;
+	uint64_t result = ((s[1] * 5) << 7 | (s[1] * 5) >> 57) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = (s[3] << 45) | (s[3] >> 19);
+	return result;
+}
+
+// Requires: 0 < n < 2^32
+// Returns: exactly uniform integer in [0, n) (Lemire's multiply-shift with
+//   rejection: the low half of x * n falls below 2^32 mod n for the few x that
+//   would favour some results, which are redrawn; the modulo is only computed
+//   when the low half is already below n)
+static inline uint32_t rng_below(struct rng* r, uint32_t n)
+{
+	uint64_t m = (rng_next(r) >> 32) * n;
+	uint32_t low = (uint32_t)m;
+	if(low < n)
+	{
+		uint32_t threshold = -n % n;
+		while(low < threshold)
+		{
+			m = (rng_next(r) >> 32) * n;
+			low = (uint32_t)m;
+		}
+	}
+	return (uint32_t)(m >> 32);
+}
+
+#endif /* #ifndef __RNG_H__ */
@@ -0,0 +1,79 @@
+#include <string.h>
+#include "tarski.h"
+#include "count.h"
+#include "rng.h"
+#include "sample.h"
+
+void sampler_init(struct world_sampler* s, const struct count_tables* t, const struct world_filter* f)
+{
+	memset(s, 0, sizeof(*s));
+
+	for(int c = 0; c < NUM_CELLS; c++)
+		if((f->region >> c) & 1)
+			s->cells[s->num_cells++] = c;
+
+	for(int size = 0; size < NUM_SIZES; size++)
+		for(int shape = 0; shape < NUM_SHAPES; shape++)
+			if(((f->sizes >> size) & 1) && ((f->shapes >> shape) & 1) && ((t->attrs[size] >> shape) & 1))
+				s->attrs[s->num_attrs++] = (1u << (15 + size)) | (1u << (12 + shape));
+
+	s->names = f->names & ALL_LABELS;
+	s->required = f->required & ALL_LABELS;
+}
+
+bool sampler_can_draw(const struct world_sampler* s, int objects_in_world)
+{
+	if(objects_in_world > s->num_cells || (s->required & ~s->names))
+		return false;
+	if(objects_in_world == 0)
+		return s->required == 0;
+	return s->num_attrs > 0;
+}
+
+void sampler_draw(const struct world_sampler* s, struct rng* r, int objects_in_world, uint32_t out[])
+{
+	int k = objects_in_world;
+	uint64_t picked = 0;
+
+	// Floyd's algorithm: a uniform k-subset of the allowed cells. Only the set
+	// matters, the objects are sorted afterwards.
+	for(int j = s->num_cells - k; j < s->num_cells; j++)
+	{
+		int t = (int)rng_below(r, j + 1);
+		if((picked >> t) & 1)
+			t = j;
+		picked |= 1ULL << t;
+	}
+
+	// Objects in increasing cell order; cells sit above the labels and below the
+	// size and shape bits, so this is not yet increasing object order
+	for(int i = 0; i < k; i++)
+	{
+		int t = __builtin_ctzll(picked);
+		picked &= picked - 1;
+		out[i] = ((uint32_t)s->cells[t] << 6) | s->attrs[rng_below(r, s->num_attrs)];
+	}
+
+	// Each name to one of the k objects, or to none unless it is required
+	for(int n = 0; n < NUM_LABELS; n++)
+	{
+		if(!((s->names >> n) & 1))
+			continue;
+		uint32_t o = rng_below(r, ((s->required >> n) & 1) ? k : k + 1);
+		if(o < (uint32_t)k)
+			out[o] |= 1u << n;
+	}
+
+	// Insertion sort into valid_objects order
+	for(int i = 1; i < k; i++)
+	{
+		uint32_t v = out[i];
+		int j = i - 1;
+		while(j >= 0 && out[j] > v)
+		{
+			out[j + 1] = out[j];
+			j--;
+		}
+		out[j + 1] = v;
+	}
+}
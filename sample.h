@@ -0,0 +1,43 @@
+#ifndef __SAMPLE_H__
+#define __SAMPLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tarski.h"
+#include "count.h"
+#include "rng.h"
+
+// Exact uniform sampling of valid worlds.
+//
+// count_worlds() factors the valid k-worlds passing a filter into
+//   C(cells, k) placements * attrs^k (size, shape) choices * label assignments,
+// and every world corresponds to exactly one choice in each factor. Drawing each
+// factor uniformly therefore draws the world uniformly: a k-subset of the allowed
+// cells (Floyd's algorithm over a 64-bit mask), an allowed (size, shape) per
+// object, and for every name one of the k objects (required names) or one of the
+// k objects or none (other allowed names). That is O(k) work per world with no
+// rejection.
+
+struct world_sampler
+{
+	uint8_t cells[NUM_CELLS];        // allowed cells in increasing order
+	int num_cells;
+	uint32_t attrs[NUM_ATTRS];       // allowed size | shape bits, ready to OR in
+	int num_attrs;
+	uint8_t names;
+	uint8_t required;
+};
+
+// Requires: t was built by count_tables_build()
+// Effects: Prepares s to sample worlds passing f
+void sampler_init(struct world_sampler* s, const struct count_tables* t, const struct world_filter* f);
+
+// Returns: true if there is at least one world of k objects to sample
+bool sampler_can_draw(const struct world_sampler* s, int objects_in_world);
+
+// Requires: sampler_can_draw(s, objects_in_world), out has objects_in_world entries
+// Effects: Writes a uniformly random valid world as packed objects in increasing
+//   order (the order the enumerator produces them in)
+void sampler_draw(const struct world_sampler* s, struct rng* r, int objects_in_world, uint32_t out[]);
+
+#endif /* #ifndef __SAMPLE_H__ */
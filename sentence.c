@@ -0,0 +1,480 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "tarski.h"
+#include "count.h"
+#include "sentence.h"
+#include "spatial.h"
+
+struct pred_info
+{
+	const char* name;
+	int arity;
+};
+
+static const struct pred_info preds[NUM_PREDS] =
+{
+	{ "Tet", 1 }, { "Cube", 1 }, { "Dodec", 1 },
+	{ "Small", 1 }, { "Medium", 1 }, { "Large", 1 },
+	{ "LeftOf", 2 }, { "RightOf", 2 }, { "FrontOf", 2 }, { "BackOf", 2 },
+	{ "SameRow", 2 }, { "SameCol", 2 }, { "SameShape", 2 }, { "SameSize", 2 },
+	{ "Adjoins", 2 }, { "Larger", 2 }, { "Smaller", 2 }, { "=", 2 },
+	{ "Between", 3 }
+};
+
+// Recursive descent parser state
+struct parser
+{
+	const char* p;
+	struct sentence* s;
+	char* err;
+	size_t err_size;
+	bool failed;
+
+	// Variables in scope, innermost last
+	char scope_name[SENTENCE_MAX_VARS][16];
+	int scope_slot[SENTENCE_MAX_VARS];
+	int scope_len;
+};
+
+static void parse_error(struct parser* ps, const char* what)
+{
+	if(!ps->failed)
+		snprintf(ps->err, ps->err_size, "%s at \"%.20s\"", what, ps->p);
+	ps->failed = true;
+}
+
+static void skip_space(struct parser* ps)
+{
+	while(isspace((unsigned char)*ps->p))
+		ps->p++;
+}
+
+// Effects: Consumes tok if it comes next
+static bool accept(struct parser* ps, const char* tok)
+{
+	skip_space(ps);
+	size_t len = strlen(tok);
+	if(strncmp(ps->p, tok, len))
+		return false;
+	// Keywords must not run into an identifier
+	if(isalpha((unsigned char)tok[0]) && isalnum((unsigned char)ps->p[len]))
+		return false;
+	ps->p += len;
+	return true;
+}
+
+static void expect(struct parser* ps, const char* tok)
+{
+	if(!accept(ps, tok))
+	{
+		char msg[32];
+		snprintf(msg, sizeof(msg), "expected '%s'", tok);
+		parse_error(ps, msg);
+	}
+}
+
+// Effects: Reads an identifier into buf, returns its length (0 if none)
+static int identifier(struct parser* ps, char* buf, size_t size)
+{
+	skip_space(ps);
+	size_t len = 0;
+	if(!isalpha((unsigned char)*ps->p))
+		return 0;
+	while(isalnum((unsigned char)ps->p[len]) || ps->p[len] == '_')
+		len++;
+	if(len >= size)
+	{
+		parse_error(ps, "identifier too long");
+		return 0;
+	}
+	memcpy(buf, ps->p, len);
+	buf[len] = 0;
+	ps->p += len;
+	return (int)len;
+}
+
+static int new_node(struct parser* ps, int op)
+{
+	if(ps->s->num_nodes == SENTENCE_MAX_NODES)
+	{
+		parse_error(ps, "sentence too long");
+		return 0;
+	}
+	int n = ps->s->num_nodes++;
+	memset(&ps->s->nodes[n], 0, sizeof(ps->s->nodes[n]));
+	ps->s->nodes[n].op = op;
+	ps->s->nodes[n].left = ps->s->nodes[n].right = -1;
+	return n;
+}
+
+// Returns: term encoding of the next name or bound variable, -1 on error
+static int parse_term(struct parser* ps)
+{
+	char id[16];
+	if(!identifier(ps, id, sizeof(id)))
+	{
+		parse_error(ps, "expected a name or variable");
+		return -1;
+	}
+	for(int i = ps->scope_len - 1; i >= 0; i--)
+		if(!strcmp(ps->scope_name[i], id))
+			return TERM_VAR + ps->scope_slot[i];
+	if(id[1] == 0 && id[0] >= 'a' && id[0] < 'a' + NUM_LABELS)
+	{
+		ps->s->names |= 1 << (id[0] - 'a');
+		return id[0] - 'a';
+	}
+	parse_error(ps, "unbound variable");
+	return -1;
+}
+
+static int parse_formula(struct parser* ps);
+
+static int parse_unary(struct parser* ps)
+{
+	char id[16];
+	const char* start;
+
+	if(ps->failed)
+		return 0;
+	if(accept(ps, "~"))
+	{
+		int n = new_node(ps, OP_NOT);
+		int body = parse_unary(ps);
+		ps->s->nodes[n].left = body;
+		return n;
+	}
+	if(accept(ps, "("))
+	{
+		int n = parse_formula(ps);
+		expect(ps, ")");
+		return n;
+	}
+
+	skip_space(ps);
+	start = ps->p;
+	bool forall = accept(ps, "forall");
+	if(forall || accept(ps, "exists"))
+	{
+		if(!identifier(ps, id, sizeof(id)) || (id[1] == 0 && id[0] >= 'a' && id[0] < 'a' + NUM_LABELS))
+		{
+			parse_error(ps, "expected a variable");
+			return 0;
+		}
+		if(ps->scope_len == SENTENCE_MAX_VARS)
+		{
+			parse_error(ps, "quantifiers nested too deeply");
+			return 0;
+		}
+
+		// Slots are reused once a quantifier's scope ends
+		int slot = ps->scope_len;
+		strcpy(ps->scope_name[ps->scope_len], id);
+		ps->scope_slot[ps->scope_len++] = slot;
+		if(slot + 1 > ps->s->num_vars)
+			ps->s->num_vars = slot + 1;
+
+		int n = new_node(ps, forall ? OP_FORALL : OP_EXISTS);
+		ps->s->nodes[n].var = slot;
+		int body = parse_unary(ps);
+		ps->s->nodes[n].left = body;
+		ps->scope_len--;
+		return n;
+	}
+
+	// Predicate application
+	ps->p = start;
+	if(isupper((unsigned char)*ps->p))
+	{
+		if(!identifier(ps, id, sizeof(id)))
+			return 0;
+		int pred;
+		for(pred = 0; pred < NUM_PREDS; pred++)
+			if(!strcmp(preds[pred].name, id))
+				break;
+		if(pred == NUM_PREDS || pred == PRED_EQUAL)
+		{
+			parse_error(ps, "unknown predicate");
+			return 0;
+		}
+		int n = new_node(ps, OP_ATOM);
+		ps->s->nodes[n].pred = pred;
+		expect(ps, "(");
+		for(int i = 0; i < preds[pred].arity && !ps->failed; i++)
+		{
+			if(i)
+				expect(ps, ",");
+			ps->s->nodes[n].arg[i] = parse_term(ps);
+		}
+		expect(ps, ")");
+		return n;
+	}
+
+	// t = t
+	int n = new_node(ps, OP_ATOM);
+	ps->s->nodes[n].pred = PRED_EQUAL;
+	ps->s->nodes[n].arg[0] = parse_term(ps);
+	expect(ps, "=");
+	ps->s->nodes[n].arg[1] = parse_term(ps);
+	return n;
+}
+
+static int parse_binary(struct parser* ps, int level);
+
+// Levels, loosest first: <->, ->, |, &
+static int parse_binary(struct parser* ps, int level)
+{
+	static const char* tok[4] = { "<->", "->", "|", "&" };
+	static const int op[4] = { OP_IFF, OP_IMPLIES, OP_OR, OP_AND };
+
+	if(level == 4)
+		return parse_unary(ps);
+
+	int left = parse_binary(ps, level + 1);
+	while(!ps->failed && accept(ps, tok[level]))
+	{
+		int n = new_node(ps, op[level]);
+		// -> and <-> group to the right, & and | to the left
+		int right = level < 2 ? parse_binary(ps, level) : parse_binary(ps, level + 1);
+		ps->s->nodes[n].left = left;
+		ps->s->nodes[n].right = right;
+		left = n;
+		if(level < 2)
+			break;
+	}
+	return left;
+}
+
+static int parse_formula(struct parser* ps)
+{
+	return parse_binary(ps, 0);
+}
+
+bool sentence_parse(const char* text, struct sentence* s, char* err, size_t err_size)
+{
+	struct parser ps;
+
+	spatial_init();
+	memset(s, 0, sizeof(*s));
+	memset(&ps, 0, sizeof(ps));
+	ps.p = text;
+	ps.s = s;
+	ps.err = err;
+	ps.err_size = err_size;
+
+	s->root = parse_formula(&ps);
+	skip_space(&ps);
+	if(!ps.failed && *ps.p)
+		parse_error(&ps, "unexpected input");
+	return !ps.failed;
+}
+
+static void print_term(int t)
+{
+	if(t >= TERM_VAR)
+		printf("%c", "xyzwvuts"[t - TERM_VAR]);
+	else
+		printf("%c", 'a' + t);
+}
+
+static void print_node(const struct sentence* s, int n)
+{
+	static const char* ops[] = { "", "~", " & ", " | ", " -> ", " <-> " };
+	const struct sentence_node* node = &s->nodes[n];
+
+	switch(node->op)
+	{
+		case OP_ATOM:
+			if(node->pred == PRED_EQUAL)
+			{
+				print_term(node->arg[0]);
+				printf(" = ");
+				print_term(node->arg[1]);
+				break;
+			}
+			printf("%s(", preds[node->pred].name);
+			for(int i = 0; i < preds[node->pred].arity; i++)
+			{
+				if(i) printf(", ");
+				print_term(node->arg[i]);
+			}
+			printf(")");
+			break;
+		case OP_NOT:
+			printf("~");
+			print_node(s, node->left);
+			break;
+		case OP_FORALL:
+		case OP_EXISTS:
+			printf("%s ", node->op == OP_FORALL ? "forall" : "exists");
+			print_term(TERM_VAR + node->var);
+			printf(" ");
+			print_node(s, node->left);
+			break;
+		default:
+			printf("(");
+			print_node(s, node->left);
+			printf("%s", ops[node->op]);
+			print_node(s, node->right);
+			printf(")");
+	}
+}
+
+void sentence_print(const struct sentence* s)
+{
+	print_node(s, s->root);
+	printf("\n");
+}
+
+void eval_world_load(struct eval_world* ew, const uint32_t w[], int sizeof_w)
+{
+	ew->num_objects = sizeof_w;
+	ew->present = (uint16_t)((1u << sizeof_w) - 1);
+	ew->names = 0;
+	ew->occupied = 0;
+	memset(ew->name_object, -1, sizeof(ew->name_object));
+
+	for(int i = 0; i < sizeof_w; i++)
+	{
+		uint32_t o = w[i];
+		uint8_t labels = OBJECT_LABELS(o);
+		ew->cell[i] = OBJECT_CELL(o);
+		ew->x[i] = CELL_X(ew->cell[i]);
+		ew->y[i] = CELL_Y(ew->cell[i]);
+		ew->occupied |= 1ULL << ew->cell[i];
+		ew->shape[i] = OBJECT_SHAPE(o) ? __builtin_ctz(OBJECT_SHAPE(o)) : 0;
+		ew->size_rank[i] = OBJECT_SIZE(o) ? 2 - __builtin_ctz(OBJECT_SIZE(o)) : 0;
+		ew->names |= labels;
+		while(labels)
+		{
+			ew->name_object[__builtin_ctz(labels)] = i;
+			labels &= labels - 1;
+		}
+	}
+}
+
+bool atom_holds(int pred, const struct eval_world* ew, int o0, int o1, int o2)
+{
+	switch(pred)
+	{
+		case PRED_TET:       return ew->shape[o0] == 2;
+		case PRED_CUBE:      return ew->shape[o0] == 1;
+		case PRED_DODEC:     return ew->shape[o0] == 0;
+		case PRED_SMALL:     return ew->size_rank[o0] == 0;
+		case PRED_MEDIUM:    return ew->size_rank[o0] == 1;
+		case PRED_LARGE:     return ew->size_rank[o0] == 2;
+		case PRED_LEFTOF:    return ew->x[o0] < ew->x[o1];
+		case PRED_RIGHTOF:   return ew->x[o0] > ew->x[o1];
+		case PRED_FRONTOF:   return ew->y[o0] > ew->y[o1];
+		case PRED_BACKOF:    return ew->y[o0] < ew->y[o1];
+		case PRED_SAMEROW:   return ew->y[o0] == ew->y[o1];
+		case PRED_SAMECOL:   return ew->x[o0] == ew->x[o1];
+		case PRED_SAMESHAPE: return ew->shape[o0] == ew->shape[o1];
+		case PRED_SAMESIZE:  return ew->size_rank[o0] == ew->size_rank[o1];
+		case PRED_ADJOINS:   return abs(ew->x[o0] - ew->x[o1]) + abs(ew->y[o0] - ew->y[o1]) == 1;
+		case PRED_LARGER:    return ew->size_rank[o0] > ew->size_rank[o1];
+		case PRED_SMALLER:   return ew->size_rank[o0] < ew->size_rank[o1];
+		case PRED_EQUAL:     return o0 == o1;
+		case PRED_BETWEEN:   return (cells_between[ew->cell[o1]][ew->cell[o2]] >> ew->cell[o0]) & 1;
+	}
+	return false;
+}
+
+// Effects: If the body of quantifier q is a spatial atom, or its negation, in which
+//   the bound variable is one argument and the others are already resolved, sets
+//   *cells to the cells where the body holds for the variable and returns true
+static bool quantified_cells(const struct sentence* s, const struct sentence_node* q, const struct eval_world* ew,
+	const int8_t env[], uint64_t* cells)
+{
+	const struct sentence_node* atom = &s->nodes[q->left];
+	bool negated = atom->op == OP_NOT;
+	int var = TERM_VAR + q->var;
+	int var_pos = -1, other[2] = { 0, 0 }, num_other = 0;
+
+	if(negated)
+		atom = &s->nodes[atom->left];
+	if(atom->op != OP_ATOM || !spatial_pred(atom->pred))
+		return false;
+
+	for(int i = 0; i < (atom->pred == PRED_BETWEEN ? 3 : 2); i++)
+	{
+		int t = atom->arg[i];
+		if(t == var)
+		{
+			if(var_pos >= 0)
+				return false;
+			var_pos = i;
+		}
+		else
+			other[num_other++] = ew->cell[t >= TERM_VAR ? env[t - TERM_VAR] : ew->name_object[t]];
+	}
+	if(var_pos < 0)
+		return false;
+
+	*cells = spatial_cells(atom->pred, var_pos, other[0], other[1]);
+	if(negated)
+		*cells = ~*cells;
+	return true;
+}
+
+static bool eval_node(const struct sentence* s, int n, const struct eval_world* ew, int8_t env[])
+{
+	const struct sentence_node* node = &s->nodes[n];
+	uint16_t objects;
+	uint64_t cells;
+
+	switch(node->op)
+	{
+		case OP_ATOM:
+		{
+			int o[3];
+			for(int i = 0; i < 3; i++)
+				o[i] = node->arg[i] >= TERM_VAR ? env[node->arg[i] - TERM_VAR] : ew->name_object[node->arg[i]];
+			return atom_holds(node->pred, ew, o[0], o[1], o[2]);
+		}
+		case OP_NOT:
+			return !eval_node(s, node->left, ew, env);
+		case OP_AND:
+			return eval_node(s, node->left, ew, env) && eval_node(s, node->right, ew, env);
+		case OP_OR:
+			return eval_node(s, node->left, ew, env) || eval_node(s, node->right, ew, env);
+		case OP_IMPLIES:
+			return !eval_node(s, node->left, ew, env) || eval_node(s, node->right, ew, env);
+		case OP_IFF:
+			return eval_node(s, node->left, ew, env) == eval_node(s, node->right, ew, env);
+		case OP_FORALL:
+			// Spatial bodies are one mask test against the occupied cells
+			if(quantified_cells(s, node, ew, env, &cells))
+				return !(ew->occupied & ~cells);
+			// Walk the present objects by bit, lowest first
+			for(objects = ew->present; objects; objects &= objects - 1)
+			{
+				env[node->var] = __builtin_ctz(objects);
+				if(!eval_node(s, node->left, ew, env))
+					return false;
+			}
+			return true;
+		case OP_EXISTS:
+			if(quantified_cells(s, node, ew, env, &cells))
+				return (ew->occupied & cells) != 0;
+			for(objects = ew->present; objects; objects &= objects - 1)
+			{
+				env[node->var] = __builtin_ctz(objects);
+				if(eval_node(s, node->left, ew, env))
+					return true;
+			}
+			return false;
+	}
+	return false;
+}
+
+int sentence_eval(const struct sentence* s, const struct eval_world* ew)
+{
+	int8_t env[SENTENCE_MAX_VARS];
+
+	if(s->names & ~ew->names)
+		return SENTENCE_UNDEFINED;
+	return eval_node(s, s->root, ew, env) ? SENTENCE_TRUE : SENTENCE_FALSE;
+}
@@ -0,0 +1,115 @@
+#ifndef __SENTENCE_H__
+#define __SENTENCE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "tarski.h"
+
+// First-order sentences of Tarski's World, evaluated on packed worlds.
+//
+// Syntax (ASCII):
+//   atoms       Tet(t) Cube(t) Dodec(t) Small(t) Medium(t) Large(t)
+//               LeftOf(t,t) RightOf(t,t) FrontOf(t,t) BackOf(t,t)
+//               SameRow(t,t) SameCol(t,t) SameShape(t,t) SameSize(t,t)
+//               Adjoins(t,t) Larger(t,t) Smaller(t,t) Between(t,t,t) t = t
+//   connectives ~ & | -> <->   (tightest to loosest, -> and <-> group right)
+//   quantifiers forall x P, exists x P   (scope is the following unit)
+//   terms       names a-f, or any other lowercase identifier bound by a quantifier
+//
+// Geometry: an object's column is x = cell >> 3, growing from left to right, and
+// its row is y = cell & 7, growing from the back to the front. So LeftOf(a,b)
+// means x(a) < x(b) and FrontOf(a,b) means y(a) > y(b). Adjoins means the cells
+// share a side. Between(a,b,c) means a, b and c lie on one row, column or
+// diagonal, with a strictly between b and c.
+//
+// A sentence that uses a name no object carries has no truth value
+// (SENTENCE_UNDEFINED), as in Tarski's World.
+
+#define SENTENCE_MAX_NODES 256
+#define SENTENCE_MAX_VARS 8
+
+// Term encoding in sentence_node.arg: names a-f are 0..5, variables TERM_VAR + slot
+#define TERM_VAR 8
+
+enum sentence_op
+{
+	OP_ATOM,
+	OP_NOT,
+	OP_AND,
+	OP_OR,
+	OP_IMPLIES,
+	OP_IFF,
+	OP_FORALL,
+	OP_EXISTS
+};
+
+enum sentence_pred
+{
+	PRED_TET, PRED_CUBE, PRED_DODEC,
+	PRED_SMALL, PRED_MEDIUM, PRED_LARGE,
+	PRED_LEFTOF, PRED_RIGHTOF, PRED_FRONTOF, PRED_BACKOF,
+	PRED_SAMEROW, PRED_SAMECOL, PRED_SAMESHAPE, PRED_SAMESIZE,
+	PRED_ADJOINS, PRED_LARGER, PRED_SMALLER, PRED_EQUAL,
+	PRED_BETWEEN,
+	NUM_PREDS
+};
+
+struct sentence_node
+{
+	uint8_t op;      // enum sentence_op
+	uint8_t pred;    // enum sentence_pred, OP_ATOM only
+	uint8_t var;     // bound slot, OP_FORALL / OP_EXISTS only
+	int8_t arg[3];   // terms, OP_ATOM only
+	int16_t left;    // operand (body of quantifiers)
+	int16_t right;   // second operand of binary connectives
+};
+
+struct sentence
+{
+	struct sentence_node nodes[SENTENCE_MAX_NODES];
+	int num_nodes;
+	int root;
+	int num_vars;    // slots used
+	uint8_t names;   // names the sentence mentions
+};
+
+enum sentence_value
+{
+	SENTENCE_FALSE = 0,
+	SENTENCE_TRUE = 1,
+	SENTENCE_UNDEFINED = -1
+};
+
+// A world decoded once for evaluation
+struct eval_world
+{
+	int num_objects;
+	uint16_t present;                        // bit i = object i exists
+	uint8_t names;                           // names carried by some object
+	int8_t name_object[6];                   // object carrying each name, -1 if none
+	uint64_t occupied;                       // cells with an object, see spatial.h
+	uint8_t cell[MAX_OBJECTS_IN_WORLD];
+	uint8_t x[MAX_OBJECTS_IN_WORLD];
+	uint8_t y[MAX_OBJECTS_IN_WORLD];
+	uint8_t shape[MAX_OBJECTS_IN_WORLD];     // shape index, see count.h
+	uint8_t size_rank[MAX_OBJECTS_IN_WORLD]; // 0 small, 1 medium, 2 large
+};
+
+// Effects: Parses text into s. On error returns false and describes it in err.
+bool sentence_parse(const char* text, struct sentence* s, char* err, size_t err_size);
+
+// Effects: Prints s back in the syntax above
+void sentence_print(const struct sentence* s);
+
+// Requires: 0 <= sizeof_w <= MAX_OBJECTS_IN_WORLD
+// Effects: Decodes packed objects for sentence_eval
+void eval_world_load(struct eval_world* ew, const uint32_t w[], int sizeof_w);
+
+// Returns: enum sentence_value of s in ew
+int sentence_eval(const struct sentence* s, const struct eval_world* ew);
+
+// Returns: truth of a single atom with its terms resolved to object indices
+bool atom_holds(int pred, const struct eval_world* ew, int o0, int o1, int o2);
+
+#endif /* #ifndef __SENTENCE_H__ */
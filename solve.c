@@ -0,0 +1,647 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tarski.h"
+#include "count.h"
+#include "sentence.h"
+#include "spatial.h"
+#include "models.h"
+#include "edit.h"
+#include "solve.h"
+
+#define TRI_FALSE 0
+#define TRI_TRUE 1
+#define TRI_UNKNOWN 2
+
+#define MAX_VARS (NUM_LABELS + 2 * MAX_OBJECTS_IN_WORLD)
+#define MAX_LITERALS 64
+#define SEARCH_DONE (MAX_VARS + 1)
+
+// Between over more cell pairs than this is left unknown
+#define BETWEEN_PAIRS_MAX 1024
+
+enum var_kind
+{
+	VAR_OWNER,
+	VAR_CELL,
+	VAR_ATTR
+};
+
+struct domains
+{
+	uint64_t cell[MAX_OBJECTS_IN_WORLD];
+	uint16_t attr[MAX_OBJECTS_IN_WORLD];  // bit size index * 3 + shape index
+	uint16_t owner[NUM_LABELS];           // bit i = object i carries the name
+};
+
+// A spatial atom between two names that must hold (or fail)
+struct literal
+{
+	uint8_t pred;
+	int8_t a, b;
+	bool positive;
+};
+
+struct solver
+{
+	const struct solve_goal* goals;
+	int num_goals;
+	struct sentence_deps* deps;
+	struct object_constraints oc;
+	struct literal literals[MAX_LITERALS];
+	int num_literals;
+	uint16_t unary_mask[PRED_LARGE + 1];   // attrs where each unary predicate holds
+	uint64_t allowed_cells;
+	uint16_t allowed_attrs;
+	uint8_t names;                         // names some goal mentions
+
+	int k;
+	int num_vars;
+	uint8_t var_kind[MAX_VARS];
+	uint8_t var_index[MAX_VARS];
+	int owner_depth[NUM_LABELS];
+	uint64_t linked_scope;                 // owner and cell variables, see goal_scope
+	int cell_depth[MAX_OBJECTS_IN_WORLD];
+	int attr_depth[MAX_OBJECTS_IN_WORLD];
+	uint64_t conflict[MAX_VARS];
+	struct domains dom;
+
+	uint32_t* out;
+	int* sizes;
+	int max_worlds;
+	int found;
+	struct solve_stats* stats;
+};
+
+static inline int attr_shape(int a)
+{
+	return a % NUM_SHAPES;
+}
+
+static inline int attr_rank(int a)
+{
+	return 2 - a / NUM_SHAPES;
+}
+
+static inline uint64_t below(int depth)
+{
+	return depth <= 0 ? 0 : (1ULL << depth) - 1;
+}
+
+static int tri_combine(int r, int v)
+{
+	return r < 0 || r == v ? v : TRI_UNKNOWN;
+}
+
+// Effects: Collects literals that hold with polarity pos under node n
+static void collect_literals(struct solver* s, const struct sentence* sn, int n, bool pos)
+{
+	const struct sentence_node* node = &sn->nodes[n];
+
+	switch(node->op)
+	{
+		case OP_NOT:
+			collect_literals(s, sn, node->left, !pos);
+			return;
+		case OP_AND:
+		case OP_OR:
+			if((node->op == OP_AND) == pos)
+			{
+				collect_literals(s, sn, node->left, pos);
+				collect_literals(s, sn, node->right, pos);
+			}
+			return;
+		case OP_IMPLIES:
+			// A -> B is false exactly when A holds and B does not
+			if(!pos)
+			{
+				collect_literals(s, sn, node->left, true);
+				collect_literals(s, sn, node->right, false);
+			}
+			return;
+		case OP_ATOM:
+			break;
+		default:
+			return;
+	}
+
+	int a = node->arg[0], b = node->arg[1];
+	if(node->pred <= PRED_LARGE && a < TERM_VAR)
+		s->oc.name_attrs[a] &= pos ? s->unary_mask[node->pred] : ~s->unary_mask[node->pred];
+	else if(node->pred == PRED_EQUAL && a < TERM_VAR && b < TERM_VAR && a != b)
+	{
+		if(pos)
+		{
+			s->oc.name_with[a] |= 1 << b;
+			s->oc.name_with[b] |= 1 << a;
+		}
+		else
+		{
+			s->oc.name_without[a] |= 1 << b;
+			s->oc.name_without[b] |= 1 << a;
+		}
+	}
+	else if(spatial_pred(node->pred) && node->pred != PRED_BETWEEN && a < TERM_VAR && b < TERM_VAR
+		&& s->num_literals < MAX_LITERALS)
+		s->literals[s->num_literals++] = (struct literal){ node->pred, a, b, pos };
+}
+
+// Returns: cells c with R(c, d) (var_pos 0) or R(d, c) (var_pos 1) for some d in
+//   cells, or with the negation of R if !positive
+static uint64_t support(int pred, int var_pos, uint64_t cells, bool positive)
+{
+	uint64_t m = 0;
+	for(; cells; cells &= cells - 1)
+	{
+		uint64_t r = spatial_cells(pred, var_pos, __builtin_ctzll(cells), 0);
+		m |= positive ? r : ~r;
+	}
+	return m;
+}
+
+#define NARROW(field, mask) \
+	do { \
+		if((field) & ~(mask)) \
+		{ \
+			(field) &= (mask); \
+			changed = true; \
+		} \
+	} while(0)
+
+// Effects: Narrows the domains to a fixpoint. Returns false if one empties.
+static bool propagate(struct solver* s, struct domains* d)
+{
+	int k = s->k;
+	bool changed = true;
+
+	while(changed)
+	{
+		changed = false;
+
+		for(int n = 0; n < NUM_LABELS; n++)
+		{
+			if(!((s->names >> n) & 1))
+				continue;
+			if(!d->owner[n])
+				return false;
+			if(d->owner[n] & (d->owner[n] - 1))
+				continue;
+			int o = __builtin_ctz(d->owner[n]);
+			NARROW(d->attr[o], s->oc.name_attrs[n]);
+			NARROW(d->cell[o], s->oc.name_cells[n]);
+			for(uint8_t m = s->oc.name_with[n] & s->names; m; m &= m - 1)
+				NARROW(d->owner[__builtin_ctz(m)], d->owner[n]);
+			for(uint8_t m = s->oc.name_without[n] & s->names; m; m &= m - 1)
+				NARROW(d->owner[__builtin_ctz(m)], ~d->owner[n]);
+		}
+
+		for(int i = 0; i < s->num_literals; i++)
+		{
+			const struct literal* l = &s->literals[i];
+			uint16_t oa = d->owner[l->a], ob = d->owner[l->b];
+			if(!oa || !ob || (oa & (oa - 1)) || (ob & (ob - 1)) || oa == ob)
+				continue;
+			int a = __builtin_ctz(oa), b = __builtin_ctz(ob);
+			NARROW(d->cell[a], support(l->pred, 0, d->cell[b], l->positive));
+			NARROW(d->cell[b], support(l->pred, 1, d->cell[a], l->positive));
+		}
+
+		// Objects in strictly increasing cell order
+		for(int i = 0; i + 1 < k; i++)
+		{
+			if(!d->cell[i])
+				return false;
+			int low = __builtin_ctzll(d->cell[i]);
+			NARROW(d->cell[i + 1], ~((2ULL << low) - 1));
+		}
+		for(int i = k - 1; i > 0; i--)
+		{
+			if(!d->cell[i])
+				return false;
+			int high = 63 - __builtin_clzll(d->cell[i]);
+			NARROW(d->cell[i - 1], (1ULL << high) - 1);
+		}
+
+		for(int i = 0; i < k; i++)
+			if(!d->cell[i] || !d->attr[i])
+				return false;
+	}
+	return true;
+}
+
+static int atom3(const struct solver* s, int pred, int o0, int o1, int o2, const struct domains* d)
+{
+	int r = -1;
+
+	if(pred <= PRED_LARGE)
+	{
+		uint16_t a = d->attr[o0], m = s->unary_mask[pred];
+		return !(a & ~m) ? TRI_TRUE : !(a & m) ? TRI_FALSE : TRI_UNKNOWN;
+	}
+
+	switch(pred)
+	{
+		case PRED_EQUAL:
+			return o0 == o1 ? TRI_TRUE : TRI_FALSE;
+		case PRED_SAMESHAPE:
+		case PRED_SAMESIZE:
+		case PRED_LARGER:
+		case PRED_SMALLER:
+			for(uint16_t a0 = d->attr[o0]; a0; a0 &= a0 - 1)
+			{
+				int a = __builtin_ctz(a0);
+				for(uint16_t a1 = o0 == o1 ? 1 << a : d->attr[o1]; a1; a1 &= a1 - 1)
+				{
+					int b = __builtin_ctz(a1);
+					bool v = pred == PRED_SAMESHAPE ? attr_shape(a) == attr_shape(b)
+						: pred == PRED_SAMESIZE ? attr_rank(a) == attr_rank(b)
+						: pred == PRED_LARGER ? attr_rank(a) > attr_rank(b)
+						: attr_rank(a) < attr_rank(b);
+					if((r = tri_combine(r, v)) == TRI_UNKNOWN)
+						return r;
+				}
+			}
+			return r < 0 ? TRI_UNKNOWN : r;
+		case PRED_BETWEEN:
+		{
+			// Between with a repeated object never holds
+			if(o0 == o1 || o0 == o2 || o1 == o2)
+				return TRI_FALSE;
+			if(__builtin_popcountll(d->cell[o1]) * __builtin_popcountll(d->cell[o2]) > BETWEEN_PAIRS_MAX)
+				return TRI_UNKNOWN;
+			bool can_true = false, can_false = false;
+			for(uint64_t c1 = d->cell[o1]; c1; c1 &= c1 - 1)
+				for(uint64_t c2 = d->cell[o2]; c2; c2 &= c2 - 1)
+				{
+					uint64_t m = cells_between[__builtin_ctzll(c1)][__builtin_ctzll(c2)];
+					can_true |= (d->cell[o0] & m) != 0;
+					can_false |= (d->cell[o0] & ~m) != 0;
+					if(can_true && can_false)
+						return TRI_UNKNOWN;
+				}
+			return can_true ? TRI_TRUE : can_false ? TRI_FALSE : TRI_UNKNOWN;
+		}
+	}
+
+	// Spatial relations between two objects
+	bool can_true = false, can_false = false;
+	if(o0 == o1)
+	{
+		for(uint64_t c = d->cell[o0]; c; c &= c - 1)
+		{
+			int cell = __builtin_ctzll(c);
+			if((r = tri_combine(r, (spatial_cells(pred, 0, cell, 0) >> cell) & 1)) == TRI_UNKNOWN)
+				return r;
+		}
+		return r < 0 ? TRI_UNKNOWN : r;
+	}
+	for(uint64_t c = d->cell[o1]; c; c &= c - 1)
+	{
+		uint64_t m = spatial_cells(pred, 0, __builtin_ctzll(c), 0);
+		can_true |= (d->cell[o0] & m) != 0;
+		can_false |= (d->cell[o0] & ~m) != 0;
+		if(can_true && can_false)
+			return TRI_UNKNOWN;
+	}
+	return can_true ? TRI_TRUE : can_false ? TRI_FALSE : TRI_UNKNOWN;
+}
+
+// Returns: the value of node n over every world the domains still allow
+static int eval3(const struct solver* s, const struct sentence* sn, int n, int8_t env[], const struct domains* d)
+{
+	const struct sentence_node* node = &sn->nodes[n];
+	int l, r;
+
+	switch(node->op)
+	{
+		case OP_ATOM:
+		{
+			// Each name may still be carried by several objects
+			uint16_t cand[3] = { 1, 1, 1 };
+			int o[3] = { 0, 0, 0 };
+			int arity = node->pred == PRED_BETWEEN ? 3 : node->pred <= PRED_LARGE ? 1 : 2;
+			for(int i = 0; i < arity; i++)
+				cand[i] = node->arg[i] >= TERM_VAR ? 1 << env[node->arg[i] - TERM_VAR] : d->owner[node->arg[i]];
+			r = -1;
+			for(uint16_t c0 = cand[0]; c0; c0 &= c0 - 1)
+				for(uint16_t c1 = cand[1]; c1; c1 &= c1 - 1)
+					for(uint16_t c2 = cand[2]; c2; c2 &= c2 - 1)
+					{
+						o[0] = __builtin_ctz(c0);
+						o[1] = __builtin_ctz(c1);
+						o[2] = __builtin_ctz(c2);
+						if((r = tri_combine(r, atom3(s, node->pred, o[0], o[1], o[2], d))) == TRI_UNKNOWN)
+							return r;
+					}
+			return r < 0 ? TRI_UNKNOWN : r;
+		}
+		case OP_NOT:
+			l = eval3(s, sn, node->left, env, d);
+			return l == TRI_UNKNOWN ? l : !l;
+		case OP_AND:
+			if((l = eval3(s, sn, node->left, env, d)) == TRI_FALSE)
+				return l;
+			r = eval3(s, sn, node->right, env, d);
+			return r == TRI_FALSE ? r : l == TRI_TRUE && r == TRI_TRUE ? TRI_TRUE : TRI_UNKNOWN;
+		case OP_OR:
+			if((l = eval3(s, sn, node->left, env, d)) == TRI_TRUE)
+				return l;
+			r = eval3(s, sn, node->right, env, d);
+			return r == TRI_TRUE ? r : l == TRI_FALSE && r == TRI_FALSE ? TRI_FALSE : TRI_UNKNOWN;
+		case OP_IMPLIES:
+			if((l = eval3(s, sn, node->left, env, d)) == TRI_FALSE)
+				return TRI_TRUE;
+			r = eval3(s, sn, node->right, env, d);
+			return r == TRI_TRUE ? r : l == TRI_TRUE && r == TRI_FALSE ? TRI_FALSE : TRI_UNKNOWN;
+		case OP_IFF:
+			l = eval3(s, sn, node->left, env, d);
+			r = eval3(s, sn, node->right, env, d);
+			return l == TRI_UNKNOWN || r == TRI_UNKNOWN ? TRI_UNKNOWN : l == r;
+		case OP_FORALL:
+		case OP_EXISTS:
+		{
+			// The quantifier's own value is decisive: false for forall, true for exists
+			int decisive = node->op == OP_EXISTS;
+			r = !decisive;
+			for(int i = 0; i < s->k; i++)
+			{
+				env[node->var] = i;
+				l = eval3(s, sn, node->left, env, d);
+				if(l == decisive)
+					return l;
+				if(l == TRI_UNKNOWN)
+					r = TRI_UNKNOWN;
+			}
+			return r;
+		}
+	}
+	return TRI_UNKNOWN;
+}
+
+// Returns: depths of the variables that can decide goal g under the current
+//   domains. Propagation ties every cell to its neighbours through the cell
+//   order and names to each other, so all owner and cell variables are in
+//   scope; attributes only of the objects that may carry the goal's names.
+static uint64_t goal_scope(const struct solver* s, int g)
+{
+	uint64_t scope = s->linked_scope;
+	uint16_t objects = 0;
+
+	if(s->deps[g].quantified)
+		return UINT64_MAX;
+	for(uint8_t names = s->goals[g].s.names; names; names &= names - 1)
+		objects |= s->dom.owner[__builtin_ctz(names)];
+	for(; objects; objects &= objects - 1)
+		scope |= 1ULL << s->attr_depth[__builtin_ctz(objects)];
+	return scope;
+}
+
+// Returns: packed object i of a fully assigned object, without labels
+static uint32_t object_body(const struct domains* d, int i)
+{
+	int a = __builtin_ctz(d->attr[i]);
+	return ((uint32_t)__builtin_ctzll(d->cell[i]) << 6) | (1u << (15 + a / NUM_SHAPES)) | (1u << (12 + a % NUM_SHAPES));
+}
+
+static inline bool fixed(const struct domains* d, int i)
+{
+	return !(d->cell[i] & (d->cell[i] - 1)) && !(d->attr[i] & (d->attr[i] - 1));
+}
+
+// Effects: Propagates and checks every constraint after assigning the variable
+//   at depth. Returns false and sets *scope to the variables involved on conflict.
+static bool consistent(struct solver* s, int depth, uint64_t* scope)
+{
+	*scope = UINT64_MAX;
+	if(!propagate(s, &s->dom))
+		return false;
+
+	// Placement rules against the other placed objects
+	if(depth >= 0 && s->var_kind[depth] != VAR_OWNER && fixed(&s->dom, s->var_index[depth]))
+	{
+		int i = s->var_index[depth];
+		uint32_t oi = object_body(&s->dom, i);
+		for(int j = 0; j < s->k; j++)
+		{
+			if(j == i || !fixed(&s->dom, j))
+				continue;
+			if(objects_conflict(oi, object_body(&s->dom, j)))
+			{
+				*scope = s->linked_scope | (1ULL << s->attr_depth[i]) | (1ULL << s->attr_depth[j]);
+				return false;
+			}
+		}
+	}
+
+	for(int g = 0; g < s->num_goals; g++)
+	{
+		int8_t env[SENTENCE_MAX_VARS];
+		int v = eval3(s, &s->goals[g].s, s->goals[g].s.root, env, &s->dom);
+		if(v != TRI_UNKNOWN && v != s->goals[g].want)
+		{
+			*scope = goal_scope(s, g);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Effects: Stores the world of the current full assignment if it checks out
+static void record(struct solver* s)
+{
+	uint32_t* w = s->out + s->found * MAX_OBJECTS_IN_WORLD;
+	struct eval_world ew;
+
+	for(int i = 0; i < s->k; i++)
+		w[i] = object_body(&s->dom, i);
+	for(uint8_t names = s->names; names; names &= names - 1)
+	{
+		int n = __builtin_ctz(names);
+		w[__builtin_ctz(s->dom.owner[n])] |= 1u << n;
+	}
+
+	// Increasing cell order is increasing object order only within one size and shape
+	for(int i = 1; i < s->k; i++)
+	{
+		uint32_t v = w[i];
+		int j = i - 1;
+		while(j >= 0 && w[j] > v)
+		{
+			w[j + 1] = w[j];
+			j--;
+		}
+		w[j + 1] = v;
+	}
+
+	if(!check_world(w, s->k))
+		return;
+	eval_world_load(&ew, w, s->k);
+	for(int g = 0; g < s->num_goals; g++)
+		if(sentence_eval(&s->goals[g].s, &ew) != s->goals[g].want)
+			return;
+	s->sizes[s->found++] = s->k;
+}
+
+// Returns: the depth to continue from, SEARCH_DONE once enough worlds are found,
+//   or -1 when the search space is exhausted
+static int search(struct solver* s, int depth)
+{
+	if(depth == s->num_vars)
+	{
+		record(s);
+		if(s->found == s->max_worlds)
+			return SEARCH_DONE;
+		// Look for the next world level by level
+		for(int d = 0; d < s->num_vars; d++)
+			s->conflict[d] |= below(d);
+		return depth - 1;
+	}
+
+	struct domains saved = s->dom;
+	int i = s->var_index[depth];
+	uint64_t values = s->var_kind[depth] == VAR_OWNER ? saved.owner[i]
+		: s->var_kind[depth] == VAR_CELL ? saved.cell[i] : saved.attr[i];
+
+	s->conflict[depth] = 0;
+	for(; values; values &= values - 1)
+	{
+		int v = __builtin_ctzll(values);
+		uint64_t scope;
+
+		s->stats->nodes++;
+		s->dom = saved;
+		switch(s->var_kind[depth])
+		{
+			case VAR_OWNER: s->dom.owner[i] = 1 << v; break;
+			case VAR_CELL:  s->dom.cell[i] = 1ULL << v; break;
+			case VAR_ATTR:  s->dom.attr[i] = 1 << v; break;
+		}
+
+		if(!consistent(s, depth, &scope))
+		{
+			s->conflict[depth] |= scope & below(depth);
+			continue;
+		}
+		int r = search(s, depth + 1);
+		if(r == SEARCH_DONE)
+			return r;
+		if(r < depth)
+		{
+			s->dom = saved;
+			return r;
+		}
+	}
+
+	s->dom = saved;
+	if(!s->conflict[depth])
+		return -1;
+	int target = 63 - __builtin_clzll(s->conflict[depth]);
+	s->conflict[target] |= s->conflict[depth] & below(target);
+	if(target < depth - 1)
+		s->stats->backjumps++;
+	return target;
+}
+
+int solve_worlds(uint32_t valid_objects[], int num_valid_objects, const struct solve_goal goals[], int num_goals,
+	const struct solve_options* opt, uint32_t out[], int sizes[], struct solve_stats* stats)
+{
+	struct solver* s = calloc(1, sizeof(*s));
+	if(!s)
+		return 0;
+	s->deps = malloc(num_goals * sizeof(*s->deps) + 1);
+	if(!s->deps)
+	{
+		free(s);
+		return 0;
+	}
+
+	s->goals = goals;
+	s->num_goals = num_goals;
+	s->out = out;
+	s->sizes = sizes;
+	s->max_worlds = opt->max_worlds;
+	s->stats = stats;
+	memset(stats, 0, sizeof(*stats));
+
+	for(int i = 0; i < num_valid_objects; i++)
+	{
+		uint32_t o = valid_objects[i];
+		s->allowed_cells |= 1ULL << OBJECT_CELL(o);
+		s->allowed_attrs |= 1 << (__builtin_ctz(OBJECT_SIZE(o)) * NUM_SHAPES + __builtin_ctz(OBJECT_SHAPE(o)));
+	}
+	for(int a = 0; a < NUM_ATTRS; a++)
+	{
+		s->unary_mask[attr_shape(a) == 0 ? PRED_DODEC : attr_shape(a) == 1 ? PRED_CUBE : PRED_TET] |= 1 << a;
+		s->unary_mask[PRED_SMALL + attr_rank(a)] |= 1 << a;
+	}
+
+	// Object constraints from every true goal, then literals from all goals
+	s->oc.all_attrs = (1 << NUM_ATTRS) - 1;
+	for(int n = 0; n < NUM_LABELS; n++)
+	{
+		s->oc.name_attrs[n] = (1 << NUM_ATTRS) - 1;
+		s->oc.name_cells[n] = ALL_CELLS;
+	}
+	for(int g = 0; g < num_goals; g++)
+	{
+		struct object_constraints oc;
+		sentence_deps_build(&goals[g].s, &s->deps[g]);
+		s->names |= goals[g].s.names;
+		if(goals[g].want != SENTENCE_TRUE)
+			continue;
+		derive_object_constraints(&goals[g].s, &oc);
+		s->oc.all_attrs &= oc.all_attrs;
+		for(int n = 0; n < NUM_LABELS; n++)
+		{
+			s->oc.name_attrs[n] &= oc.name_attrs[n];
+			s->oc.name_cells[n] &= oc.name_cells[n];
+			s->oc.name_with[n] |= oc.name_with[n];
+			s->oc.name_without[n] |= oc.name_without[n];
+		}
+	}
+	for(int g = 0; g < num_goals; g++)
+		collect_literals(s, &goals[g].s, goals[g].s.root, goals[g].want == SENTENCE_TRUE);
+
+	for(int k = opt->min_objects; k <= opt->max_objects && s->found < s->max_worlds; k++)
+	{
+		// Every mentioned name needs an object
+		if(k == 0 && s->names)
+			continue;
+
+		s->k = k;
+		s->num_vars = 0;
+		s->linked_scope = 0;
+		memset(&s->dom, 0, sizeof(s->dom));
+		for(int n = 0; n < NUM_LABELS; n++)
+		{
+			if(!((s->names >> n) & 1))
+				continue;
+			s->dom.owner[n] = (1 << k) - 1;
+			s->owner_depth[n] = s->num_vars;
+			s->linked_scope |= 1ULL << s->num_vars;
+			s->var_kind[s->num_vars] = VAR_OWNER;
+			s->var_index[s->num_vars++] = n;
+		}
+		for(int i = 0; i < k; i++)
+		{
+			s->dom.cell[i] = s->allowed_cells;
+			s->dom.attr[i] = s->allowed_attrs & s->oc.all_attrs;
+			s->cell_depth[i] = s->num_vars;
+			s->linked_scope |= 1ULL << s->num_vars;
+			s->var_kind[s->num_vars] = VAR_CELL;
+			s->var_index[s->num_vars++] = i;
+			s->attr_depth[i] = s->num_vars;
+			s->var_kind[s->num_vars] = VAR_ATTR;
+			s->var_index[s->num_vars++] = i;
+		}
+
+		uint64_t scope;
+		if(consistent(s, -1, &scope))
+			search(s, 0);
+	}
+
+	int found = s->found;
+	free(s->deps);
+	free(s);
+	return found;
+}
@@ -0,0 +1,59 @@
+#ifndef __SOLVE_H__
+#define __SOLVE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tarski.h"
+#include "sentence.h"
+
+// Search for valid worlds in which every sentence of a set has a wanted value.
+//
+// For each k in the requested range the solver works on variables rather than on
+// combinations of valid_objects: the owner (object index) of each name the
+// sentences mention, then the cell and the (size, shape) of objects 0..k-1.
+// Domains are bit masks. Objects are kept in increasing cell order, which
+// both breaks their symmetry and enforces distinct cells.
+//
+// After each assignment:
+//   - propagation narrows domains: the single-object constraints models.c derives
+//     from true sentences (see derive_object_constraints), arc consistency on
+//     spatial literals between names, name equalities, and the cell order
+//   - every sentence is evaluated in three-valued logic over the domains; an
+//     atom is true or false only if it is so for every value still possible
+//   - an object whose cell and attributes are both fixed is checked against the
+//     other fixed objects with location_check_v2; labels cannot clash, since each
+//     name has exactly one owner
+// A failure records the variables in scope of the failed constraint, and an
+// exhausted variable jumps back to the latest of them (conflict-directed
+// backjumping). Every world found is checked with check_world and sentence_eval.
+//
+// Names no sentence mentions are left off the worlds found, so each world stands
+// for all the ways of placing those names on its objects.
+
+struct solve_goal
+{
+	struct sentence s;
+	int want;               // SENTENCE_TRUE or SENTENCE_FALSE
+};
+
+struct solve_options
+{
+	int min_objects;
+	int max_objects;
+	int max_worlds;         // stop after this many worlds
+};
+
+struct solve_stats
+{
+	uint64_t nodes;         // assignments tried
+	uint64_t backjumps;     // returns that skipped at least one level
+};
+
+// Requires: out holds max_worlds * MAX_OBJECTS_IN_WORLD entries, sizes holds max_worlds
+// Effects: Finds up to max_worlds distinct worlds, smallest k first, writing world i
+//   to out + i * MAX_OBJECTS_IN_WORLD (objects in increasing order) and its size to
+//   sizes[i]. Returns the number found.
+int solve_worlds(uint32_t valid_objects[], int num_valid_objects, const struct solve_goal goals[], int num_goals,
+	const struct solve_options* opt, uint32_t out[], int sizes[], struct solve_stats* stats);
+
+#endif /* #ifndef __SOLVE_H__ */
@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include "count.h"
+#include "sentence.h"
+#include "spatial.h"
+
+uint64_t cells_left_of[64];
+uint64_t cells_right_of[64];
+uint64_t cells_front_of[64];
+uint64_t cells_back_of[64];
+uint64_t cells_same_row[64];
+uint64_t cells_same_col[64];
+uint64_t cells_adjoining[64];
+uint64_t cells_between[64][64];
+uint64_t cells_beyond[64][64];
+
+static bool spatial_ready = false;
+
+static inline int sign(int v)
+{
+	return (v > 0) - (v < 0);
+}
+
+// Returns: true if a is strictly inside the segment b-c along a row, column or diagonal
+static bool cell_between(int a, int b, int c)
+{
+	int dx1 = CELL_X(a) - CELL_X(b), dy1 = CELL_Y(a) - CELL_Y(b);
+	int dx2 = CELL_X(c) - CELL_X(a), dy2 = CELL_Y(c) - CELL_Y(a);
+	if(!(dx1 == 0 || dy1 == 0 || abs(dx1) == abs(dy1)) || (dx1 == 0 && dy1 == 0))
+		return false;
+	if(!(dx2 == 0 || dy2 == 0 || abs(dx2) == abs(dy2)) || (dx2 == 0 && dy2 == 0))
+		return false;
+	return sign(dx1) == sign(dx2) && sign(dy1) == sign(dy2);
+}
+
+void spatial_init(void)
+{
+	if(spatial_ready)
+		return;
+
+	for(int c = 0; c < NUM_CELLS; c++)
+	{
+		int cx = CELL_X(c), cy = CELL_Y(c);
+		for(int d = 0; d < NUM_CELLS; d++)
+		{
+			int dx = CELL_X(d), dy = CELL_Y(d);
+			uint64_t bit = 1ULL << d;
+			if(dx < cx) cells_left_of[c] |= bit;
+			if(dx > cx) cells_right_of[c] |= bit;
+			if(dy > cy) cells_front_of[c] |= bit;
+			if(dy < cy) cells_back_of[c] |= bit;
+			if(dy == cy) cells_same_row[c] |= bit;
+			if(dx == cx) cells_same_col[c] |= bit;
+			if(abs(dx - cx) + abs(dy - cy) == 1) cells_adjoining[c] |= bit;
+		}
+	}
+
+	for(int b = 0; b < NUM_CELLS; b++)
+		for(int c = 0; c < NUM_CELLS; c++)
+			for(int d = 0; d < NUM_CELLS; d++)
+			{
+				if(cell_between(d, b, c))
+					cells_between[b][c] |= 1ULL << d;
+				if(cell_between(b, d, c))
+					cells_beyond[b][c] |= 1ULL << d;
+			}
+
+	spatial_ready = true;
+}
+
+bool spatial_pred(int pred)
+{
+	return (pred >= PRED_LEFTOF && pred <= PRED_SAMECOL) || pred == PRED_ADJOINS || pred == PRED_BETWEEN;
+}
+
+uint64_t spatial_cells(int pred, int var_pos, int c0, int c1)
+{
+	// R(c0, d) is the converse relation with d first
+	switch(pred)
+	{
+		case PRED_LEFTOF:  return var_pos == 0 ? cells_left_of[c0] : cells_right_of[c0];
+		case PRED_RIGHTOF: return var_pos == 0 ? cells_right_of[c0] : cells_left_of[c0];
+		case PRED_FRONTOF: return var_pos == 0 ? cells_front_of[c0] : cells_back_of[c0];
+		case PRED_BACKOF:  return var_pos == 0 ? cells_back_of[c0] : cells_front_of[c0];
+		case PRED_SAMEROW: return cells_same_row[c0];
+		case PRED_SAMECOL: return cells_same_col[c0];
+		case PRED_ADJOINS: return cells_adjoining[c0];
+		case PRED_BETWEEN:
+			// Between(b, d, c) and Between(b, c, d) are the same condition
+			return var_pos == 0 ? cells_between[c0][c1] : cells_beyond[c0][c1];
+	}
+	return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef __SPATIAL_H__
+#define __SPATIAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Spatial relations of the board as 64-bit cell masks, bit c = cell c.
+//
+// Every spatial predicate depends only on the cells of its arguments, so for a
+// fixed cell the cells standing in a relation to it form a bitboard. With the
+// world's occupancy bitboard (one bit per object), "some object x with R(x, c)"
+// is occupied & mask != 0 and "every object x has R(x, c)" is
+// (occupied & ~mask) == 0, with no loop over the objects.
+//
+// Orientation as in sentence.h: x = cell >> 3 grows to the right, y = cell & 7
+// grows to the front.
+
+extern uint64_t cells_left_of[64];       // cells d with LeftOf(d, c)
+extern uint64_t cells_right_of[64];      // cells d with RightOf(d, c)
+extern uint64_t cells_front_of[64];      // cells d with FrontOf(d, c)
+extern uint64_t cells_back_of[64];       // cells d with BackOf(d, c)
+extern uint64_t cells_same_row[64];      // including c
+extern uint64_t cells_same_col[64];      // including c
+extern uint64_t cells_adjoining[64];     // cells sharing a side with c
+extern uint64_t cells_between[64][64];   // cells d with Between(d, b, c)
+extern uint64_t cells_beyond[64][64];    // cells d with Between(b, d, c)
+
+// Effects: Fills the tables; later calls do nothing. Must run before the first
+//   use and before any other thread reads them.
+void spatial_init(void);
+
+// Returns: true if pred (enum sentence_pred) is decided by cells alone
+bool spatial_pred(int pred);
+
+// Requires: spatial_pred(pred), spatial_init() has run
+// Returns: cells d such that pred holds with d as argument var_pos and the other
+//   arguments, in order, on cells c0 and c1 (c1 only for Between)
+uint64_t spatial_cells(int pred, int var_pos, int c0, int c1);
+
+#endif /* #ifndef __SPATIAL_H__ */
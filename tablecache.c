@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tarski.h"
+#include "count.h"
+#include "tablecache.h"
+
+static void cache_key(struct table_cache_key* key)
+{
+	memset(key, 0, sizeof(*key));
+	key->version = TABLE_CACHE_VERSION;
+	key->board_cells = NUM_CELLS;
+	key->num_labels = NUM_LABELS;
+	key->allowed_sizes = ALLOWED_SIZES;
+	key->max_objects_in_world = MAX_OBJECTS_IN_WORLD;
+	key->num_valid_objects = NUM_VALID_OBJECTS;
+	key->bn_bytes = sizeof(struct bn);
+	key->payload_bytes = sizeof(struct table_cache_data);
+}
+
+// Returns: 64-bit checksum of len bytes, word-wise FNV-1a followed by a final avalanche
+static uint64_t cache_checksum(const void* p, size_t len)
+{
+	const uint8_t* b = p;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for(size_t i = 0; i + 8 <= len; i += 8)
+	{
+		uint64_t w;
+		memcpy(&w, b + i, 8);
+		h ^= w;
+		h *= 0x100000001b3ULL;
+	}
+	for(size_t i = len & ~(size_t)7; i < len; i++)
+	{
+		h ^= b[i];
+		h *= 0x100000001b3ULL;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static const char* cache_path(void)
+{
+	const char* path = getenv("TARSKI_CACHE");
+	if(!path)
+		return TABLE_CACHE_DEFAULT_PATH;
+	return *path ? path : NULL;
+}
+
+// Effects: Maps path if it holds tables for this configuration
+static bool cache_map(struct table_cache* c, const char* path)
+{
+	struct table_cache_header expect;
+	struct stat st;
+	size_t len = sizeof(struct table_cache_header) + sizeof(struct table_cache_data);
+
+	int fd = open(path, O_RDONLY);
+	if(fd < 0)
+		return false;
+	if(fstat(fd, &st) < 0 || (size_t)st.st_size != len)
+	{
+		close(fd);
+		return false;
+	}
+	void* map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+		return false;
+
+	const struct table_cache_header* h = map;
+	const struct table_cache_data* data = (const void*)(h + 1);
+
+	memcpy(expect.magic, TABLE_CACHE_MAGIC, sizeof(expect.magic));
+	cache_key(&expect.key);
+	if(memcmp(h->magic, expect.magic, sizeof(h->magic)) || memcmp(&h->key, &expect.key, sizeof(h->key))
+		|| h->checksum != cache_checksum(data, sizeof(*data)))
+	{
+		munmap(map, len);
+		return false;
+	}
+
+	c->map = map;
+	c->map_len = len;
+	c->data = data;
+	return true;
+}
+
+// Effects: Writes c->owned to path via a temporary file. Failure is not fatal.
+static void cache_save(const struct table_cache* c, const char* path)
+{
+	struct table_cache_header h;
+	char tmp[4096];
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, TABLE_CACHE_MAGIC, sizeof(h.magic));
+	cache_key(&h.key);
+	h.checksum = cache_checksum(c->owned, sizeof(*c->owned));
+
+	snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+	FILE* f = fopen(tmp, "wb");
+	if(!f)
+		return;
+	bool ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(c->owned, sizeof(*c->owned), 1, f) == 1;
+	ok = (fclose(f) == 0) && ok;
+	if(!ok || rename(tmp, path) < 0)
+	{
+		fprintf(stderr, "Could not write table cache %s\n", path);
+		unlink(tmp);
+	}
+}
+
+bool table_cache_load(struct table_cache* c)
+{
+	const char* path = cache_path();
+
+	memset(c, 0, sizeof(*c));
+	if(path && cache_map(c, path))
+		return true;
+
+	// Missing, stale or corrupt: rebuild
+	c->owned = calloc(1, sizeof(*c->owned));
+	if(!c->owned)
+	{
+		perror("calloc");
+		return false;
+	}
+	c->owned->num_valid_objects = generate_valid_objects(c->owned->valid_objects);
+	c->owned->tables_ok = count_tables_build(&c->owned->tables, c->owned->valid_objects, c->owned->num_valid_objects);
+	c->data = c->owned;
+
+	if(path)
+		cache_save(c, path);
+	return true;
+}
+
+void table_cache_release(struct table_cache* c)
+{
+	if(c->map)
+		munmap(c->map, c->map_len);
+	free(c->owned);
+	memset(c, 0, sizeof(*c));
+}
@@ -0,0 +1,78 @@
+#ifndef __TABLECACHE_H__
+#define __TABLECACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "tarski.h"
+#include "count.h"
+
+// On-disk memoization of the precomputed tables.
+//
+// The cache file is a header followed by one struct table_cache_data. The header
+// records the configuration the tables were built for and a checksum of the
+// payload; a file whose key or checksum does not match is treated as stale, the
+// tables are rebuilt and the file is replaced (write to a temporary, then rename).
+// A matching file is mapped read-only and used in place, so short-lived worker
+// and query processes skip generation entirely.
+//
+// The path comes from $TARSKI_CACHE, default TABLE_CACHE_DEFAULT_PATH; an empty
+// $TARSKI_CACHE disables the file and always builds in memory.
+
+#define TABLE_CACHE_MAGIC "TWCACHE"
+#define TABLE_CACHE_VERSION 1
+#define TABLE_CACHE_DEFAULT_PATH "tarski.cache"
+
+// Everything that changes the tables' contents or layout
+struct table_cache_key
+{
+	uint32_t version;
+	uint32_t board_cells;
+	uint32_t num_labels;
+	uint32_t allowed_sizes;
+	uint32_t max_objects_in_world;
+	uint32_t num_valid_objects;
+	uint32_t bn_bytes;
+	uint32_t payload_bytes;
+};
+
+struct table_cache_header
+{
+	char magic[8];
+	struct table_cache_key key;
+	uint64_t checksum; // of the payload
+	uint8_t reserved[16];
+};
+
+struct table_cache_data
+{
+	uint32_t valid_objects[NUM_VALID_OBJECTS];
+	int32_t num_valid_objects;
+	int32_t tables_ok; // count_tables_build() succeeded
+	struct count_tables tables;
+};
+
+struct table_cache
+{
+	const struct table_cache_data* data;
+	void* map;                     // non-null if data points into a mapped file
+	size_t map_len;
+	struct table_cache_data* owned; // non-null if data was built in memory
+};
+
+// Effects: Maps a valid cache file or rebuilds (and tries to save) the tables.
+//   Returns false only if memory for the tables could not be allocated.
+bool table_cache_load(struct table_cache* c);
+void table_cache_release(struct table_cache* c);
+
+// Convenience accessors; tables is NULL if valid_objects has no closed-form tables
+static inline uint32_t* table_cache_valid_objects(const struct table_cache* c)
+{
+	return (uint32_t*)c->data->valid_objects;
+}
+static inline const struct count_tables* table_cache_tables(const struct table_cache* c)
+{
+	return c->data->tables_ok ? &c->data->tables : NULL;
+}
+
+#endif /* #ifndef __TABLECACHE_H__ */
@@ -0,0 +1,68 @@
+#ifndef __TARSKI_H__
+#define __TARSKI_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bn.h"
+
+// Shared declarations for the world enumerator in world.c and the modes built
+// on top of it.
+//
+// Object encoding (18-bit numbers):
+//   bits 0-5   labels (names a-f, one bit each)
+//   bits 6-11  location (cell = x * 8 + y)
+//   bits 12-14 shape {Dodecahedron, Cube, Tetrahedron}
+//   bits 15-17 size {Large, Medium, Small}
+
+// Sizes generate_valid_objects() admits, bit i = size bit 15 + i (Large, Medium, Small).
+// NUM_VALID_OBJECTS must stay 64 cells * 64 label masks * 3 shapes * allowed sizes.
+#define ALLOWED_SIZES 6
+#define NUM_VALID_OBJECTS 24576
+#define MAX_OBJECTS_IN_WORLD 12
+
+bool letter_check(uint32_t sizeof_w, uint32_t* w);
+bool location_check_v2(uint32_t sizeof_w, uint32_t* w);
+int check_world(uint32_t w[], int sizeof_w);
+
+// Returns: true if objects a and b cannot be in one world (shared names, or
+//   locations that clash in either order)
+bool objects_conflict(uint32_t a, uint32_t b);
+
+void print_world(uint32_t w[], int sizeof_w);
+void print_bignum(struct bn* a);
+
+// Requires: valid_objects has room for NUM_VALID_OBJECTS entries
+// Modifies: valid_objects
+// Effects: Fills valid_objects in increasing order, returns the number of objects
+int generate_valid_objects(uint32_t valid_objects[]);
+
+// Requires: 0 <= objects_in_world <= MAX_OBJECTS_IN_WORLD
+// Modifies: *count
+// Effects: Adds to *count the number of valid worlds of objects_in_world objects
+//   whose first (lowest) index into valid_objects lies in [first_lead, last_lead).
+//   The empty world is counted by the lead range containing 0.
+void count_level(uint32_t valid_objects[], int objects_in_world, int first_lead, int last_lead, struct bn* count);
+
+// Requires: 0 <= objects_in_world <= MAX_OBJECTS_IN_WORLD
+// Modifies: *count
+// Effects: As count_level, but over the cell order of cellorder.h (built once from
+//   its own copy of valid_objects; safe to call from any thread): a lead is the
+//   index of a world's first object in that order. Its lead ranges partition the
+//   worlds too, but not the same way, so shards of one level must all use one of
+//   the two counters. [0, NUM_VALID_OBJECTS) is the whole level either way.
+void count_level_by_cell(int objects_in_world, int first_lead, int last_lead, struct bn* count);
+
+// Called once per accepted world. w holds the objects, indices their positions in
+// valid_objects; both are only valid for the duration of the call.
+typedef void (*world_visitor)(uint32_t w[], const int indices[], int sizeof_w, void* ctx);
+
+// Same as count_level (leads index valid_objects), and additionally calls visit (if non-null) for every accepted world
+void enumerate_level(uint32_t valid_objects[], int objects_in_world, int first_lead, int last_lead,
+	struct bn* count, world_visitor visit, void* ctx);
+
+// Same as enumerate_level over an arbitrary increasing subset of valid_objects
+// (leads and indices refer to positions in objects)
+void enumerate_objects(uint32_t objects[], int num_objects, int objects_in_world, int first_lead, int last_lead,
+	struct bn* count, world_visitor visit, void* ctx);
+
+#endif /* #ifndef __TARSKI_H__ */
@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "bn.h"
+#include "tarski.h"
+#include "kernels.h"
+#include "cellorder.h"
+
+// The world checks, the valid-object table and the enumeration and counting
+// entry points of tarski.h, shared by the tarski binary and libtarski.
+
+// Requires: w is non-null, sizeof_w == length of w
+// Modifies: none
+// Returns: true if no labels are repeated, else false
+bool letter_check(uint32_t sizeof_w, uint32_t* w)
+{
+	// All the labels in use
+	uint8_t labels = 0;
+	uint8_t label; // The current labels on the object
+	
+	for(uint32_t i = 0; i < sizeof_w; i++)
+	{
+		label = w[i] & 63;
+		if(labels & label) return false;
+		labels = labels | label; 
+	}
+	return true;
+}
+
+bool location_check_v2(uint32_t sizeof_w, uint32_t* w)
+{
+	// World representation: Each column is two bits (reversed), each row is each element in the array
+	// Please note the the right side is x == 0, leftside is x == 7
+	// If the point has 0, nothing occupies it
+	// If the point has 1, a center occupies it
+	// If the point has 2, a edge of a large object occupies it
+	uint16_t world[8] = {0,0,0,0,0,0,0,0};
+	
+	for(uint32_t i = 0; i < sizeof_w; i++)
+	{
+		uint8_t c = (w[i] >> 6) & 63;
+		
+		uint8_t cy = c & 7;
+		uint8_t cx = (c >> 2) & 14; // We want this to be multiplied by 2 - really the shift left
+
+		// Y position above and below the center
+		uint8_t by = cy + 1;
+		uint8_t ty = cy - 1;
+		
+		uint8_t large = (w[i] >> 15) & 1;
+
+		// Placement of object
+		if((world[cy] >> cx) & 3) // If center is occupied by 1 or 2
+			return false;
+		
+		world[cy] = world[cy] | (1 << cx); 
+		if(large) 
+		{ // Bound search
+			uint16_t e_bit =  (2 << cx);
+			if(cx != 14) 
+			{ // Check "left" side
+				if((world[cy] >> cx) & 4) return false; // If space if occupied by a center
+				else world[cy] = world[cy] | (e_bit << 2);
+			}
+			if(cx) 
+			{ // Check "right" side - x >= 2
+				if((world[cy] >> (cx - 2)) & 1) return false; // If space if occupied by a center
+				else world[cy] = world[cy] | (e_bit >> 2);
+			}
+
+			if(cy != 7) 
+			{ // Check bottom
+				if((world[by] >> cx) & 1) return false;
+				else world[by] = world[by] | e_bit;
+			}
+			if(cy) 
+			{ // Check top (y != 0)
+				if((world[ty] >> cx) & 1) return false;
+				else world[ty] = world[ty] | e_bit;
+			}
+
+			// Edge cases
+			if(cx != 14 && cy) 
+			{ // Check "left" and up side
+				if((world[ty] >> cx) & 4) return false; // If space if occupied by a center
+				else world[ty] = world[ty] | (e_bit << 2);
+			}
+
+			if(cx && cy) 
+			{ // Check "right" and up side - x >= 2
+				if((world[ty] >> (cx - 2)) & 1) return false; // If space if occupied by a center
+				else world[ty] = world[ty] | (e_bit >> 2);
+			}
+
+			if(cx != 14 && cy != 7) 
+			{ // Check "left" and bottom side
+				if((world[by] >> cx) & 4) return false; // If space if occupied by a center
+				else world[by] = world[by] | (e_bit << 2);
+			}
+
+			if(cx && cy != 7) 
+			{ // Check "right" and bottom side - x >= 2
+				if((world[by] >> (cx - 2)) & 1) return false; // If space if occupied by a center
+				else world[by] = world[by] | (e_bit >> 2);
+			}	    
+		}
+	}
+	
+	return true;
+}
+
+// Requires: l contains 2 valid objects (18-bit numbers)
+// Returns: true if the locations of the objects do not conflict
+bool location_check(uint32_t l_[])
+{
+	int c0c = (l_[0] & 4032) >> 6;
+	int c1c = (l_[1] & 4032) >> 6;
+	
+	int c0x = (c0c & 56) >> 3;
+	int c0y = c0c & 7;
+	
+	int c1x = (c1c & 56) >> 3;
+	int c1y = c1c & 7;
+	
+	int c0large = (l_[0] & (1 << 15)) >> 15;
+	int c1large = (l_[1] & (1 << 15)) >> 15;
+	
+	// if they are the exact same location, return false
+	if(!(c0c ^ c1c))
+	return false;
+	
+	// if either shape is large
+	if(c0large | c1large)
+	{
+		// Their centers must at least have 1 square between them
+		if(!((abs(c0x - c1x) > 1) || (abs(c0y - c1y) > 1)))
+		return false;
+	}
+	return true;
+}
+
+// Requires: Requires: sizeof_w == length of w
+// Modifies: nothing
+// Effects: Prints all elements of w[] with spaces, and a new line at the end
+// Note: Only for debugging; never actually called
+void print_world(uint32_t w[], int sizeof_w)
+{
+	int ii = 0;
+	for(ii = 0; ii < sizeof_w; ii++)
+	printf("%d ",w[ii]);
+	printf("\n");
+}
+
+// Requires: *a : a reference to a non-null big num
+// Modifies: nothing
+// Effects: Prints a 'bignum' (IN HEX)
+void print_bignum(struct bn* a)
+{
+	char buf[4096];
+	bignum_to_string(a, buf, sizeof(buf));
+	// bignum_to_string drops every leading zero, leaving nothing for zero
+	printf("bignum (hex) = %s\n", buf[0] ? buf : "0");
+}
+
+bool objects_conflict(uint32_t a, uint32_t b)
+{
+	uint32_t ab[2] = { a, b }, ba[2] = { b, a };
+	return !letter_check(2, ab) || !location_check_v2(2, ab) || !location_check_v2(2, ba);
+}
+
+int check_world(uint32_t w[], int sizeof_w)
+{	
+	// If a given world does not have 2 or more objects, it is automatically
+	//  valid, since there is nothing that can be invalid
+	if(sizeof_w < 2) return 1;
+
+	if(!letter_check(sizeof_w, w))
+		return 0;
+	
+	if(!(location_check_v2(sizeof_w, w)))
+		return 0;
+	
+	return 1;
+}
+
+_Static_assert(NUM_VALID_OBJECTS == 64 * 64 * 3 * ((ALLOWED_SIZES & 1) + ((ALLOWED_SIZES >> 1) & 1) + ((ALLOWED_SIZES >> 2) & 1)),
+	"NUM_VALID_OBJECTS does not match ALLOWED_SIZES");
+
+int generate_valid_objects(uint32_t valid_objects[])
+{
+	int s, m, l, t, c, d, i, j;
+
+	j = 0;
+
+	// Goes through all potential objects (all 18 digit numbers)
+	for(i = 0; i <= 262143; i++)
+	{
+		// Isolates the relevant bit to each possible size or shape
+		//  Sizes: {Small, Medium, Large}
+		//  Shapes: {Tetrahedron, Cube, Dodecahedron}
+		s = (i >> 17) & 1;
+		m = (i >> 16) & 1;
+		l = (i >> 15) & 1;
+		t = (i >> 14) & 1;
+		c = (i >> 13) & 1;
+		d = (i >> 12) & 1;
+
+		if(((i >> 15) & 7) & ~ALLOWED_SIZES) continue;
+		
+		// Ensures only 1 size and shape bit is on for any given valid object
+		if(!((s ^ m) ^ l) ^ (s & m & l))
+			continue;
+		if(!((t ^ c) ^ d) ^ (t & c & d)) 
+			continue;
+		
+		// Any object that has met these requirements is valid, and can be added to the array
+		valid_objects[j] = i;
+		j++;
+	}
+	return j;
+}
+
+void enumerate_objects(uint32_t objects[], int num_objects, int objects_in_world, int first_lead, int last_lead,
+	struct bn* count, world_visitor visit, void* ctx)
+{
+	int indices[MAX_OBJECTS_IN_WORLD];
+
+	// The empty world has no lead object; it belongs to the range starting at 0
+	if(objects_in_world == 0)
+	{
+		if(first_lead <= 0 && last_lead > 0)
+		{
+			bignum_inc(count);
+			if(visit) visit(NULL, indices, 0, ctx);
+		}
+		return;
+	}
+
+	// No combination can start past the last possible lead
+	if(last_lead > num_objects - objects_in_world + 1)
+		last_lead = num_objects - objects_in_world + 1;
+	if(first_lead < 0)
+		first_lead = 0;
+	if(first_lead >= last_lead)
+		return;
+
+	// One dispatch per call; the kernel for this size does the rest
+	struct bn accepted;
+	bignum_from_int(&accepted, enumerate_kernels[objects_in_world](objects, num_objects, first_lead, last_lead, visit, ctx));
+	bignum_add(count, &accepted, count);
+}
+
+void enumerate_level(uint32_t valid_objects[], int objects_in_world, int first_lead, int last_lead,
+	struct bn* count, world_visitor visit, void* ctx)
+{
+	enumerate_objects(valid_objects, NUM_VALID_OBJECTS, objects_in_world, first_lead, last_lead, count, visit, ctx);
+}
+
+// valid_objects in cell order, built once from a private table so concurrent
+// callers share nothing but the finished order
+static struct cell_order count_order;
+
+static void build_count_order(void)
+{
+	static uint32_t objects[NUM_VALID_OBJECTS];
+
+	generate_valid_objects(objects);
+	if(!cell_order_build(&count_order, objects, NUM_VALID_OBJECTS))
+	{
+		perror("cell_order_build");
+		exit(1);
+	}
+}
+
+void count_level(uint32_t valid_objects[], int objects_in_world, int first_lead, int last_lead, struct bn* count)
+{
+	enumerate_level(valid_objects, objects_in_world, first_lead, last_lead, count, NULL, NULL);
+}
+
+void count_level_by_cell(int objects_in_world, int first_lead, int last_lead, struct bn* count)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	pthread_once(&once, build_count_order);
+	cell_order_count(&count_order, objects_in_world, first_lead, last_lead, count);
+}
@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tarski.h"
+#include "worldfile.h"
+
+// Worlds are appended into this buffer and written out in one go
+#define WORLD_WRITER_BUFFER (4 << 20)
+
+uint32_t world_record_size(int objects_in_world, enum world_encoding encoding)
+{
+	if(encoding == WORLD_ENCODING_INDEX16)
+		return 2 * objects_in_world;
+	return (WORLD_FILE_OBJECT_BITS * objects_in_world + 7) / 8;
+}
+
+static void writer_flush(struct world_writer* wr)
+{
+	const uint8_t* p = wr->buf;
+	size_t len = wr->buf_len;
+	while(len && !wr->failed)
+	{
+		ssize_t n = write(wr->fd, p, len);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0)
+		{
+			perror("write");
+			wr->failed = true;
+			break;
+		}
+		p += n;
+		len -= n;
+	}
+	wr->buf_len = 0;
+}
+
+bool world_writer_open(struct world_writer* wr, const char* path, int objects_in_world, enum world_encoding encoding)
+{
+	memset(wr, 0, sizeof(*wr));
+	memcpy(wr->header.magic, WORLD_FILE_MAGIC, sizeof(wr->header.magic));
+	wr->header.version = WORLD_FILE_VERSION;
+	wr->header.objects_in_world = objects_in_world;
+	wr->header.encoding = encoding;
+	wr->header.object_bits = WORLD_FILE_OBJECT_BITS;
+	wr->header.record_size = world_record_size(objects_in_world, encoding);
+
+	wr->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(wr->fd < 0)
+	{
+		perror(path);
+		return false;
+	}
+
+	// Round the buffer down to whole records so a flush never splits one
+	wr->buf_cap = WORLD_WRITER_BUFFER;
+	if(wr->header.record_size)
+		wr->buf_cap -= wr->buf_cap % wr->header.record_size;
+	wr->buf = malloc(wr->buf_cap);
+	if(!wr->buf)
+	{
+		perror("malloc");
+		close(wr->fd);
+		return false;
+	}
+
+	memcpy(wr->buf, &wr->header, sizeof(wr->header));
+	wr->buf_len = sizeof(wr->header);
+	writer_flush(wr);
+	return !wr->failed;
+}
+
+void world_writer_add(struct world_writer* wr, const uint32_t w[], const int indices[])
+{
+	uint32_t k = wr->header.objects_in_world;
+	uint32_t size = wr->header.record_size;
+
+	if(wr->buf_len + size > wr->buf_cap)
+		writer_flush(wr);
+
+	uint8_t* rec = wr->buf + wr->buf_len;
+	wr->buf_len += size;
+	wr->header.world_count++;
+
+	if(wr->header.encoding == WORLD_ENCODING_INDEX16)
+	{
+		for(uint32_t j = 0; j < k; j++)
+		{
+			rec[2 * j] = indices[j] & 255;
+			rec[2 * j + 1] = indices[j] >> 8;
+		}
+		return;
+	}
+
+	// Shift the objects through a 64-bit accumulator, emitting whole bytes
+	uint64_t acc = 0;
+	int bits = 0;
+	for(uint32_t j = 0; j < k; j++)
+	{
+		acc |= (uint64_t)(w[j] & 0x3FFFF) << bits;
+		bits += WORLD_FILE_OBJECT_BITS;
+		while(bits >= 8)
+		{
+			*rec++ = acc & 255;
+			acc >>= 8;
+			bits -= 8;
+		}
+	}
+	if(bits)
+		*rec = acc & 255;
+}
+
+bool world_writer_close(struct world_writer* wr)
+{
+	writer_flush(wr);
+
+	// Now that the count is known, rewrite the header in place
+	if(!wr->failed && pwrite(wr->fd, &wr->header, sizeof(wr->header), 0) != sizeof(wr->header))
+	{
+		perror("pwrite");
+		wr->failed = true;
+	}
+	if(close(wr->fd) < 0)
+		wr->failed = true;
+	free(wr->buf);
+	wr->buf = NULL;
+	return !wr->failed;
+}
+
+bool world_reader_open(struct world_reader* rd, const char* path, int num_valid_objects)
+{
+	struct stat st;
+
+	memset(rd, 0, sizeof(*rd));
+	rd->num_valid_objects = num_valid_objects;
+	rd->fd = open(path, O_RDONLY);
+	if(rd->fd < 0)
+	{
+		perror(path);
+		return false;
+	}
+	if(fstat(rd->fd, &st) < 0 || (size_t)st.st_size < sizeof(struct world_file_header))
+	{
+		fprintf(stderr, "%s: not a world file\n", path);
+		close(rd->fd);
+		return false;
+	}
+
+	rd->map_len = st.st_size;
+	void* map = mmap(NULL, rd->map_len, PROT_READ, MAP_SHARED, rd->fd, 0);
+	if(map == MAP_FAILED)
+	{
+		perror("mmap");
+		close(rd->fd);
+		return false;
+	}
+
+	rd->header = map;
+	rd->records = (const uint8_t*)map + sizeof(struct world_file_header);
+
+	// Every field is checked before it sizes anything; the division keeps a huge
+	// world_count from wrapping the length check
+	const struct world_file_header* h = rd->header;
+	if(memcmp(h->magic, WORLD_FILE_MAGIC, sizeof(h->magic)) || h->version != WORLD_FILE_VERSION
+		|| h->object_bits != WORLD_FILE_OBJECT_BITS
+		|| (h->encoding != WORLD_ENCODING_PACKED18 && h->encoding != WORLD_ENCODING_INDEX16)
+		|| h->objects_in_world > MAX_OBJECTS_IN_WORLD
+		|| h->record_size != world_record_size(h->objects_in_world, h->encoding)
+		|| (h->record_size && h->world_count > (rd->map_len - sizeof(*h)) / h->record_size))
+	{
+		fprintf(stderr, "%s: not a world file or truncated\n", path);
+		world_reader_close(rd);
+		return false;
+	}
+	return true;
+}
+
+void world_reader_close(struct world_reader* rd)
+{
+	if(rd->header)
+		munmap((void*)rd->header, rd->map_len);
+	if(rd->fd >= 0)
+		close(rd->fd);
+	rd->header = NULL;
+	rd->fd = -1;
+}
+
+bool world_reader_get(const struct world_reader* rd, uint64_t n, uint32_t out[], const uint32_t valid_objects[])
+{
+	const uint8_t* rec = world_reader_record(rd, n);
+	uint32_t k = rd->header->objects_in_world;
+
+	if(rd->header->encoding == WORLD_ENCODING_INDEX16)
+	{
+		for(uint32_t j = 0; j < k; j++)
+		{
+			int index = rec[2 * j] | (rec[2 * j + 1] << 8);
+			if(index >= rd->num_valid_objects)
+				return false;
+			out[j] = valid_objects[index];
+		}
+		return true;
+	}
+
+	uint64_t acc = 0;
+	int bits = 0;
+	for(uint32_t j = 0; j < k; j++)
+	{
+		while(bits < WORLD_FILE_OBJECT_BITS)
+		{
+			acc |= (uint64_t)*rec++ << bits;
+			bits += 8;
+		}
+		out[j] = acc & 0x3FFFF;
+		acc >>= WORLD_FILE_OBJECT_BITS;
+		bits -= WORLD_FILE_OBJECT_BITS;
+	}
+	return true;
+}
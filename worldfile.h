@@ -0,0 +1,94 @@
+#ifndef __WORLDFILE_H__
+#define __WORLDFILE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Binary world files: a 64-byte header followed by fixed-size records, one per
+// world, so the n-th world lives at header + n * record_size. All fields are
+// little-endian.
+//
+// Encodings:
+//   WORLD_ENCODING_PACKED18 - k objects of 18 bits each, object j at bit 18*j of
+//                             the record, record_size = ceil(18k / 8)
+//   WORLD_ENCODING_INDEX16  - k uint16 indices into valid_objects, record_size = 2k
+
+#define WORLD_FILE_MAGIC "TWWORLDS"
+#define WORLD_FILE_VERSION 1
+#define WORLD_FILE_OBJECT_BITS 18
+
+enum world_encoding
+{
+	WORLD_ENCODING_PACKED18 = 0,
+	WORLD_ENCODING_INDEX16 = 1
+};
+
+struct world_file_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t objects_in_world; // k
+	uint32_t encoding;         // enum world_encoding
+	uint32_t object_bits;      // 18
+	uint32_t record_size;      // bytes per world
+	uint32_t reserved0;
+	uint64_t world_count;      // filled in by world_writer_close
+	uint8_t reserved[24];
+};
+
+struct world_writer
+{
+	int fd;
+	struct world_file_header header;
+	uint8_t* buf;
+	size_t buf_len;
+	size_t buf_cap;
+	bool failed;
+};
+
+struct world_reader
+{
+	int fd;
+	const struct world_file_header* header;
+	const uint8_t* records;
+	size_t map_len;
+	int num_valid_objects;     // bound on WORLD_ENCODING_INDEX16 indices
+};
+
+// Returns: bytes per record for k objects in the given encoding
+uint32_t world_record_size(int objects_in_world, enum world_encoding encoding);
+
+// Effects: Creates path and writes a provisional header. Returns false on error.
+bool world_writer_open(struct world_writer* wr, const char* path, int objects_in_world, enum world_encoding encoding);
+
+// Requires: w and indices hold objects_in_world entries (indices may be NULL for
+//   WORLD_ENCODING_PACKED18)
+// Effects: Appends one world to the write buffer, flushing it when full
+void world_writer_add(struct world_writer* wr, const uint32_t w[], const int indices[]);
+
+// Effects: Flushes, records the final world count in the header and closes.
+//   Returns false if any write failed.
+bool world_writer_close(struct world_writer* wr);
+
+// Effects: Maps path read-only. Returns false if it is not a world file, has an
+//   unknown encoding, more than MAX_OBJECTS_IN_WORLD objects per world or fewer
+//   records than its header claims. Index16 records will be checked against
+//   num_valid_objects.
+bool world_reader_open(struct world_reader* rd, const char* path, int num_valid_objects);
+void world_reader_close(struct world_reader* rd);
+
+// Returns: pointer into the mapping for world n (no copy)
+static inline const uint8_t* world_reader_record(const struct world_reader* rd, uint64_t n)
+{
+	return rd->records + n * rd->header->record_size;
+}
+
+// Requires: n < header->world_count, out has room for objects_in_world entries,
+//   valid_objects is the table the file was written with (only read for
+//   WORLD_ENCODING_INDEX16)
+// Effects: Decodes world n into packed uint32 objects. Returns false if an index
+//   lies outside valid_objects.
+bool world_reader_get(const struct world_reader* rd, uint64_t n, uint32_t out[], const uint32_t valid_objects[]);
+
+#endif /* #ifndef __WORLDFILE_H__ */
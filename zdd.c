@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bn.h"
+#include "tarski.h"
+#include "count.h"
+#include "rng.h"
+#include "zdd.h"
+
+#define ZDD_CACHE_BITS 20
+
+enum zdd_op
+{
+	ZDD_OP_INTERSECT = 1
+};
+
+static int compare_cell_major(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	if(OBJECT_CELL(x) != OBJECT_CELL(y))
+		return OBJECT_CELL(x) < OBJECT_CELL(y) ? -1 : 1;
+	return x < y ? -1 : x > y;
+}
+
+static inline uint32_t node_hash(int var, int lo, int hi)
+{
+	uint64_t h = (uint64_t)(uint32_t)var * 0x9e3779b97f4a7c15ULL;
+	h ^= (uint64_t)(uint32_t)lo * 0xc2b2ae3d27d4eb4fULL;
+	h ^= (uint64_t)(uint32_t)hi * 0x165667b19e3779f9ULL;
+	return (uint32_t)(h ^ (h >> 29));
+}
+
+bool zdd_init(struct zdd* z, const uint32_t objects[], int num_objects)
+{
+	memset(z, 0, sizeof(*z));
+	z->objects = malloc(num_objects * sizeof(*z->objects) + 1);
+	z->cap_nodes = 1 << 16;
+	z->nodes = malloc(z->cap_nodes * sizeof(*z->nodes));
+	z->unique_mask = (1u << 17) - 1;
+	z->unique = calloc(z->unique_mask + 1, sizeof(*z->unique));
+	z->cache_mask = (1u << ZDD_CACHE_BITS) - 1;
+	z->cache = calloc(z->cache_mask + 1, sizeof(*z->cache));
+	if(!z->objects || !z->nodes || !z->unique || !z->cache)
+	{
+		zdd_free(z);
+		return false;
+	}
+
+	memcpy(z->objects, objects, num_objects * sizeof(*objects));
+	qsort(z->objects, num_objects, sizeof(*z->objects), compare_cell_major);
+	z->num_vars = num_objects;
+
+	// Terminals
+	z->nodes[ZDD_EMPTY] = (struct zdd_node){ num_objects, ZDD_EMPTY, ZDD_EMPTY };
+	z->nodes[ZDD_BASE] = (struct zdd_node){ num_objects, ZDD_BASE, ZDD_BASE };
+	z->num_nodes = 2;
+	return true;
+}
+
+void zdd_free(struct zdd* z)
+{
+	free(z->objects);
+	free(z->nodes);
+	free(z->unique);
+	free(z->cache);
+	free(z->counts);
+	memset(z, 0, sizeof(*z));
+}
+
+// Effects: Doubles the unique table
+static bool grow_unique(struct zdd* z)
+{
+	uint32_t mask = z->unique_mask * 2 + 1;
+	int32_t* unique = calloc(mask + 1, sizeof(*unique));
+	if(!unique)
+		return false;
+	for(int id = 2; id < z->num_nodes; id++)
+	{
+		const struct zdd_node* n = &z->nodes[id];
+		uint32_t h = node_hash(n->var, n->lo, n->hi) & mask;
+		while(unique[h])
+			h = (h + 1) & mask;
+		unique[h] = id;
+	}
+	free(z->unique);
+	z->unique = unique;
+	z->unique_mask = mask;
+	return true;
+}
+
+int zdd_node(struct zdd* z, int var, int lo, int hi)
+{
+	if(hi == ZDD_EMPTY)
+		return lo;
+	if(lo < 0 || hi < 0)
+		return -1;
+
+	uint32_t h = node_hash(var, lo, hi) & z->unique_mask;
+	for(int id; (id = z->unique[h]); h = (h + 1) & z->unique_mask)
+	{
+		const struct zdd_node* n = &z->nodes[id];
+		if(n->var == var && n->lo == lo && n->hi == hi)
+			return id;
+	}
+
+	if(z->num_nodes == z->cap_nodes)
+	{
+		struct zdd_node* nodes = realloc(z->nodes, 2 * z->cap_nodes * sizeof(*nodes));
+		if(!nodes)
+			return -1;
+		z->nodes = nodes;
+		z->cap_nodes *= 2;
+	}
+	int id = z->num_nodes++;
+	z->nodes[id] = (struct zdd_node){ var, lo, hi };
+	z->unique[h] = id;
+
+	// Keep the table at most half full
+	if((uint32_t)z->num_nodes * 2 > z->unique_mask && !grow_unique(z))
+		return -1;
+	return id;
+}
+
+int zdd_valid_worlds(struct zdd* z)
+{
+	// next[labels][taken]: family for the objects after var, given the names
+	// used so far and whether the cell of var is taken
+	int32_t next[64][2], cur[64][2];
+
+	for(int i = 0; i < z->num_vars; i++)
+		if(OBJECT_SIZE(z->objects[i]) & 1)
+			return -1;
+
+	for(int l = 0; l < 64; l++)
+		next[l][0] = next[l][1] = ZDD_BASE;
+
+	for(int var = z->num_vars - 1; var >= 0; var--)
+	{
+		uint32_t o = z->objects[var];
+		uint8_t labels = OBJECT_LABELS(o);
+		// The next variable starts a new cell, where nothing is taken yet
+		bool last_in_cell = var + 1 == z->num_vars || OBJECT_CELL(z->objects[var + 1]) != OBJECT_CELL(o);
+
+		for(int l = 0; l < 64; l++)
+		{
+			for(int taken = 0; taken < 2; taken++)
+			{
+				int lo = next[l][last_in_cell ? 0 : taken];
+				int hi = ZDD_EMPTY;
+				if(!taken && !(l & labels))
+					hi = next[l | labels][last_in_cell ? 0 : 1];
+				if((cur[l][taken] = zdd_node(z, var, lo, hi)) < 0)
+					return -1;
+			}
+		}
+		memcpy(next, cur, sizeof(next));
+	}
+	return next[0][0];
+}
+
+int zdd_allowed(struct zdd* z, bool (*allowed)(uint32_t o, void* ctx), void* ctx)
+{
+	int f = ZDD_BASE;
+	for(int var = z->num_vars - 1; var >= 0 && f >= 0; var--)
+		if(allowed(z->objects[var], ctx))
+			f = zdd_node(z, var, f, f);
+	return f;
+}
+
+int zdd_with_names(struct zdd* z, uint8_t names)
+{
+	// next[carried]: family for the objects after var given the names carried so far
+	int32_t next[64], cur[64];
+
+	names &= ALL_LABELS;
+	for(int c = 0; c < 64; c++)
+		next[c] = c == names ? ZDD_BASE : ZDD_EMPTY;
+
+	for(int var = z->num_vars - 1; var >= 0; var--)
+	{
+		uint8_t labels = OBJECT_LABELS(z->objects[var]) & names;
+		for(int c = 0; c < 64; c++)
+		{
+			if((c & names) != c)
+				continue;
+			if((cur[c] = zdd_node(z, var, next[c], next[c | labels])) < 0)
+				return -1;
+		}
+		memcpy(next, cur, sizeof(next));
+	}
+	return next[0];
+}
+
+// Returns: true if f contains the empty world
+static bool has_empty(const struct zdd* z, int f)
+{
+	while(f > ZDD_BASE)
+		f = z->nodes[f].lo;
+	return f == ZDD_BASE;
+}
+
+int zdd_intersect(struct zdd* z, int f, int g)
+{
+	if(f < 0 || g < 0)
+		return -1;
+	if(f == ZDD_EMPTY || g == ZDD_EMPTY)
+		return ZDD_EMPTY;
+	if(f == g)
+		return f;
+	if(f == ZDD_BASE)
+		return has_empty(z, g) ? ZDD_BASE : ZDD_EMPTY;
+	if(g == ZDD_BASE)
+		return has_empty(z, f) ? ZDD_BASE : ZDD_EMPTY;
+	if(f > g)
+	{
+		int t = f;
+		f = g;
+		g = t;
+	}
+
+	struct zdd_cache_entry* e = &z->cache[node_hash(ZDD_OP_INTERSECT, f, g) & z->cache_mask];
+	if(e->op == ZDD_OP_INTERSECT && e->f == f && e->g == g)
+		return e->result;
+
+	// Copy: the node array may move while recursing
+	struct zdd_node nf = z->nodes[f], ng = z->nodes[g];
+	int r;
+	if(nf.var < ng.var)
+		r = zdd_intersect(z, nf.lo, g);
+	else if(nf.var > ng.var)
+		r = zdd_intersect(z, f, ng.lo);
+	else
+		r = zdd_node(z, nf.var, zdd_intersect(z, nf.lo, ng.lo), zdd_intersect(z, nf.hi, ng.hi));
+
+	e = &z->cache[node_hash(ZDD_OP_INTERSECT, f, g) & z->cache_mask];
+	*e = (struct zdd_cache_entry){ ZDD_OP_INTERSECT, f, g, r };
+	return r;
+}
+
+// Effects: Extends the per-node counts to every node created so far
+static bool prepare_counts(struct zdd* z)
+{
+	if(z->counted == z->num_nodes)
+		return true;
+
+	zdd_count_t (*counts)[MAX_OBJECTS_IN_WORLD + 1] = realloc(z->counts, z->num_nodes * sizeof(*counts));
+	if(!counts)
+		return false;
+	z->counts = counts;
+
+	if(z->counted == 0)
+	{
+		memset(counts[ZDD_EMPTY], 0, sizeof(counts[ZDD_EMPTY]));
+		memset(counts[ZDD_BASE], 0, sizeof(counts[ZDD_BASE]));
+		counts[ZDD_BASE][0] = 1;
+		z->counted = 2;
+	}
+	// Children have lower ids, so one pass in id order suffices
+	for(int id = z->counted; id < z->num_nodes; id++)
+	{
+		const zdd_count_t* lo = counts[z->nodes[id].lo];
+		const zdd_count_t* hi = counts[z->nodes[id].hi];
+		counts[id][0] = lo[0];
+		for(int k = 1; k <= MAX_OBJECTS_IN_WORLD; k++)
+		{
+			// Saturate instead of wrapping; an overflowed child overflows its parent
+			zdd_count_t sum = lo[k] + hi[k - 1];
+			bool overflow = lo[k] == ZDD_COUNT_OVERFLOW || hi[k - 1] == ZDD_COUNT_OVERFLOW || sum < lo[k];
+			counts[id][k] = overflow ? ZDD_COUNT_OVERFLOW : sum;
+		}
+	}
+	z->counted = z->num_nodes;
+	return true;
+}
+
+bool zdd_count(struct zdd* z, int f, struct bn counts[MAX_OBJECTS_IN_WORLD + 1])
+{
+	bool ok = f >= 0 && prepare_counts(z);
+	for(int k = 0; ok && k <= MAX_OBJECTS_IN_WORLD; k++)
+		ok = z->counts[f][k] != ZDD_COUNT_OVERFLOW;
+	for(int k = 0; k <= MAX_OBJECTS_IN_WORLD; k++)
+	{
+		if(ok)
+			bignum_from_u128(z->counts[f][k], &counts[k]);
+		else
+			bignum_init(&counts[k]);
+	}
+	return ok;
+}
+
+// Returns: uniform integer in [0, n), n > 0
+static zdd_count_t random_below(struct rng* r, zdd_count_t n)
+{
+	zdd_count_t mask = n - 1;
+	for(int shift = 1; shift < 128; shift *= 2)
+		mask |= mask >> shift;
+	while(true)
+	{
+		zdd_count_t x = (((zdd_count_t)rng_next(r) << 64) | rng_next(r)) & mask;
+		if(x < n)
+			return x;
+	}
+}
+
+bool zdd_sample(struct zdd* z, int f, int k, struct rng* r, uint32_t out[])
+{
+	if(f < 0 || k < 0 || k > MAX_OBJECTS_IN_WORLD || !prepare_counts(z) || z->counts[f][k] == 0
+		|| z->counts[f][k] == ZDD_COUNT_OVERFLOW)
+		return false;
+
+	int n = 0;
+	while(f > ZDD_BASE)
+	{
+		const struct zdd_node* node = &z->nodes[f];
+		zdd_count_t with = k > 0 ? z->counts[node->hi][k - 1] : 0;
+		zdd_count_t without = z->counts[node->lo][k];
+		if(random_below(r, with + without) < with)
+		{
+			out[n++] = z->objects[node->var];
+			f = node->hi;
+			k--;
+		}
+		else
+			f = node->lo;
+	}
+
+	// Cell-major back to valid_objects order
+	for(int i = 1; i < n; i++)
+	{
+		uint32_t v = out[i];
+		int j = i - 1;
+		while(j >= 0 && out[j] > v)
+		{
+			out[j + 1] = out[j];
+			j--;
+		}
+		out[j + 1] = v;
+	}
+	return true;
+}
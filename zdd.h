@@ -0,0 +1,98 @@
+#ifndef __ZDD_H__
+#define __ZDD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bn.h"
+#include "tarski.h"
+#include "rng.h"
+
+// Zero-suppressed decision diagrams over the objects of valid_objects.
+//
+// A ZDD node (var, lo, hi) is the family of worlds without object var (lo) plus
+// the worlds of hi with object var added. Nodes are hash-consed through a unique
+// table, so equal families are equal node ids, and a node with hi = ZDD_EMPTY is
+// never created. Children always have lower ids than their parents.
+//
+// Variables are the objects in cell-major order: all objects of cell 0, then of
+// cell 1, and so on. In that order check_world needs only the names used so far
+// and whether the current cell is taken, so the family of valid worlds compiles
+// to one node per reachable (object, names used, cell taken) state after merging.
+// Large objects would make placement depend on neighbouring cells, so
+// zdd_valid_worlds refuses object lists that contain them.
+//
+// Counts and samples are per number of objects k <= MAX_OBJECTS_IN_WORLD and take
+// time linear in the number of nodes. Per-node counts are 128-bit integers, exact
+// for every family under zdd_valid_worlds: none has more than
+// C(64, 12) * 6^12 * 13^6 < 2^95 members of one size. The families zdd_allowed and
+// zdd_with_names build on their own can reach C(24576, 12), about 2^146; a count
+// that does not fit saturates at ZDD_COUNT_OVERFLOW, and zdd_count and zdd_sample
+// refuse it rather than use a wrapped value.
+
+#define ZDD_EMPTY 0   // no worlds
+#define ZDD_BASE 1    // only the empty world
+
+typedef unsigned __int128 zdd_count_t;
+
+#define ZDD_COUNT_OVERFLOW (~(zdd_count_t)0)   // 2^128 - 1 or more
+
+struct zdd_node
+{
+	int32_t var;      // num_vars for the terminals
+	int32_t lo;
+	int32_t hi;
+};
+
+struct zdd_cache_entry
+{
+	int32_t op;
+	int32_t f;
+	int32_t g;
+	int32_t result;
+};
+
+struct zdd
+{
+	uint32_t* objects;                   // object of each variable
+	int num_vars;
+	struct zdd_node* nodes;
+	int num_nodes;
+	int cap_nodes;
+	int32_t* unique;                     // open addressing, 0 = free slot
+	uint32_t unique_mask;
+	struct zdd_cache_entry* cache;       // operation cache, direct mapped
+	uint32_t cache_mask;
+	zdd_count_t (*counts)[MAX_OBJECTS_IN_WORLD + 1];
+	int counted;                         // nodes [0, counted) have counts
+};
+
+// Effects: Creates an empty store over objects, reordered cell-major. Returns false
+//   on allocation failure.
+bool zdd_init(struct zdd* z, const uint32_t objects[], int num_objects);
+void zdd_free(struct zdd* z);
+
+// Returns: the node (var, lo, hi), or lo if hi is ZDD_EMPTY; -1 on allocation failure
+int zdd_node(struct zdd* z, int var, int lo, int hi);
+
+// Returns: the family of worlds passing check_world, -1 if it cannot be built
+int zdd_valid_worlds(struct zdd* z);
+
+// Returns: every set of objects for which allowed holds
+int zdd_allowed(struct zdd* z, bool (*allowed)(uint32_t o, void* ctx), void* ctx);
+
+// Returns: every set of objects that carries each name in names
+int zdd_with_names(struct zdd* z, uint8_t names);
+
+// Returns: f intersected with g
+int zdd_intersect(struct zdd* z, int f, int g);
+
+// Effects: counts[k] = number of worlds in f with k objects. Returns false, with
+//   every count 0, if f is not a diagram, the per-node counts could not be
+//   allocated or one of them does not fit 128 bits.
+bool zdd_count(struct zdd* z, int f, struct bn counts[MAX_OBJECTS_IN_WORLD + 1]);
+
+// Effects: Draws a uniform world of f with k objects into out, in increasing
+//   object order. Returns false if f has none or too many to count.
+bool zdd_sample(struct zdd* z, int f, int k, struct rng* r, uint32_t out[]);
+
+#endif /* #ifndef __ZDD_H__ */